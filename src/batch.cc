@@ -0,0 +1,82 @@
+#include "batch.hpp"
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "expectimax.hpp"
+#include "position_format.hpp"
+#include "search_budget.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+struct BatchLine {
+	std::optional<Node> node;
+	std::string error;
+	ActionValues action_values;
+};
+
+void solve_chunk(std::vector<BatchLine> &chunk, std::ostream &out, bool report) {
+	thread_pool.parallel_for(static_cast<int>(chunk.size()), [&](int i) {
+		if (chunk[i].node) {
+			chunk[i].action_values = solve_for_answer(chunk[i].node.value(), report);
+		}
+	});
+
+	for (const BatchLine &line : chunk) {
+		if (line.node) {
+			write_answer(out, line.action_values, report);
+			out << '\n';
+		}
+		else {
+			out << "error\t" << line.error << '\n';
+		}
+	}
+	out.flush();
+	chunk.clear();
+}
+}  // namespace
+
+ActionValues solve_for_answer(const Node &node, bool report) {
+	// A limited search also tells how deep it got, which the answer has to mark.
+	if (report || search_limits.is_limited()) {
+		return node.get_action_values();
+	}
+	ActionValues action_values;
+	const auto [action, ev] = node.get_best_action();
+	action_values.push(action, ev);
+	return action_values;
+}
+
+void write_answer(std::ostream &out, const ActionValues &action_values, bool report) {
+	const int action_count = report ? action_values.size() : 1;
+	for (int i = 0; i < action_count; i++) {
+		const auto [action, ev] = action_values[i];
+		out << (i > 0 ? "\t" : "") << action_to_str(action) << '\t' << ev;
+	}
+	if (!action_values.is_exact()) {
+		out << "\testimate\t" << action_values.get_depth();
+	}
+}
+
+void solve_batch(std::istream &in, std::ostream &out, int chunk_size, bool report) {
+	std::vector<BatchLine> chunk;
+	std::string line;
+
+	while (std::getline(in, line)) {
+		if (line.empty() || line[0] == '#') {
+			continue;
+		}
+
+		BatchLine &batch_line = chunk.emplace_back();
+		batch_line.node = parse_position(line, batch_line.error);
+
+		if (static_cast<int>(chunk.size()) >= chunk_size) {
+			solve_chunk(chunk, out, report);
+		}
+	}
+
+	if (!chunk.empty()) {
+		solve_chunk(chunk, out, report);
+	}
+}
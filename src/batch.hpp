@@ -0,0 +1,25 @@
+#ifndef BATCH_HPP
+#define BATCH_HPP
+
+#include <istream>
+#include <ostream>
+
+#include "expectimax.hpp"
+
+// Reads one position per line from `in` (see position_format.hpp) and writes one line per
+// position to `out`: "<action>\t<ev>", or "error\t<message>" if the line can't be parsed. With
+// `report` set, the line continues with the "\t<action>\t<ev>" pairs of all other legal actions,
+// best first. If a search budget ran out before the root was solved exactly, the line ends with
+// "\testimate\t<plies>", the depth of the deepest finished iteration. Empty lines and lines
+// starting with '#' produce no output. Positions are solved in chunks of `chunk_size` lines
+// spread over the thread pool, all sharing the warm transposition table. With a chunk size of 1
+// every answer is flushed before the next line is read.
+void solve_batch(std::istream &in, std::ostream &out, int chunk_size, bool report);
+
+// Solves one position for an answer line. Without `report` or search limits only the best
+// action is needed, which the solution cache can answer without searching.
+ActionValues solve_for_answer(const Node &node, bool report);
+// Writes the answer line for `action_values`, without the trailing newline.
+void write_answer(std::ostream &out, const ActionValues &action_values, bool report);
+
+#endif  // BATCH_HPP
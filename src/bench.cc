@@ -0,0 +1,611 @@
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <new>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "cli_utils.hpp"
+#include "expectimax.hpp"
+#include "item_manager.hpp"
+#include "policy.hpp"
+#include "reload.hpp"
+#include "reload_values.hpp"
+#include "search_stats.hpp"
+#include "tablebase.hpp"
+#include "thread_pool.hpp"
+#include "transposition_table.hpp"
+
+// Calls of the global allocation functions, counted to check that searches don't allocate.
+std::atomic<uint64_t> allocation_count = 0;
+
+void *operator new(std::size_t size) {
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+		return ptr;
+	}
+	throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return ::operator new(size); }
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+void operator delete[](void *ptr, std::size_t) noexcept { std::free(ptr); }
+
+// Positions that take less than this in the baseline are too noisy for the slowdown check.
+constexpr double MIN_COMPARED_WALL_MS = 1.0;
+// Decisions of each policy that `--policy` solves again from scratch, spread over the policy.
+constexpr std::size_t POLICY_RESOLVED_DECISIONS = 16;
+// Policy lookups timed per position, cycling through its decisions.
+constexpr std::size_t POLICY_LOOKUPS = 1 << 20;
+
+struct BenchPosition {
+	std::string name;
+	Node node;
+};
+
+struct BenchResult {
+	std::string name;
+	Action action;
+	float ev;
+	double wall_ms;
+	// Allocations made by the last run, after earlier runs warmed up all reusable buffers.
+	uint64_t allocations;
+	SearchStats stats;
+};
+
+struct PolicyBenchResult {
+	std::string name;
+	std::size_t decisions;
+	std::size_t file_bytes;
+	double build_ms;
+	double lookup_ns;
+	// Mean time of solving one of the sampled decisions from a cold transposition table.
+	double resolve_ms;
+	// Sampled decisions whose search disagrees with the policy.
+	int mismatches;
+};
+
+struct BaselineResult {
+	double ev;
+	double wall_ms;
+	double nodes_visited;
+	// Missing in baselines written before allocations were counted.
+	std::optional<double> allocations;
+};
+
+// Fixed corpus of player-turn positions. Names encode the round, lives (dealer v player), shells
+// (live/blank) and the item loadouts, so results stay comparable when positions are added.
+std::vector<BenchPosition> make_corpus(void) {
+	auto position = [](std::string name, int max_lives, int dealer_lives, int player_lives,
+	                   int live, int blank, bool known_live, bool known_blank,
+	                   ItemManager dealer_items, ItemManager player_items) {
+		return BenchPosition{std::move(name),
+		                     Node(false, known_live, known_blank, live, blank, max_lives,
+		                          dealer_lives, player_lives, dealer_items, player_items)};
+	};
+	const ItemManager none;
+
+	std::vector<BenchPosition> corpus = {
+	    position("r1_2v2_1l2b", 2, 2, 2, 1, 2, false, false, none, none),
+	    position("r1_1v2_2l2b", 2, 1, 2, 2, 2, false, false, none, none),
+	    position("r1_2v1_4l4b", 2, 2, 1, 4, 4, false, false, none, none),
+	    position("r2_4v4_2l3b_light", 4, 4, 4, 2, 3, false, false, ItemManager(1, 1, 0, 0, 0),
+	             ItemManager(0, 1, 1, 0, 0)),
+	    position("r2_3v4_3l3b_mixed", 4, 3, 4, 3, 3, false, false, ItemManager(1, 0, 1, 0, 1),
+	             ItemManager(1, 0, 1, 1, 0)),
+	    position("r2_2v3_4l4b_mixed", 4, 2, 3, 4, 4, false, false, ItemManager(0, 1, 1, 1, 0),
+	             ItemManager(1, 1, 0, 0, 1)),
+	    position("r3_4v5_1l1b_known_blank", 6, 4, 5, 1, 1, false, true, none,
+	             ItemManager(1, 0, 0, 0, 0)),
+	    position("r3_5v4_3l2b_known_live", 6, 5, 4, 3, 2, true, false,
+	             ItemManager(2, 1, 0, 1, 0), ItemManager(1, 1, 2, 0, 1)),
+	    position("r3_3v6_2l4b_mixed", 6, 3, 6, 2, 4, false, false, ItemManager(0, 2, 1, 0, 1),
+	             ItemManager(2, 0, 1, 1, 0)),
+	    position("r3_2v2_5l3b_mixed", 6, 2, 2, 5, 3, false, false, ItemManager(1, 1, 2, 0, 0),
+	             ItemManager(1, 2, 0, 1, 1)),
+	    position("r3_6v5_3l5b_full", 6, 6, 5, 3, 5, false, false, ItemManager(2, 0, 1, 1, 2),
+	             ItemManager(1, 1, 1, 2, 1)),
+	    position("r3_6v6_4l4b_full", 6, 6, 6, 4, 4, false, false, ItemManager(1, 1, 1, 1, 1),
+	             ItemManager(1, 1, 1, 1, 1)),
+	    position("r3_6v6_4l4b_heavy", 6, 6, 6, 4, 4, false, false, ItemManager(2, 2, 2, 1, 1),
+	             ItemManager(2, 1, 2, 1, 1)),
+	    position("r1_2v2_2l2b_reload2", 2, 2, 2, 2, 2, false, false, none, none),
+	};
+	corpus.back().node.set_reloads_left(2);
+	return corpus;
+}
+
+// Solves `position` from a cold transposition table `repeat` times and keeps the fastest run.
+BenchResult run_position(const BenchPosition &position, int repeat) {
+	BenchResult result = {position.name, Action::SHOOT_DEALER, 0.0f, 0.0, 0, {}};
+	result.wall_ms = std::numeric_limits<double>::max();
+
+	for (int i = 0; i < repeat; i++) {
+		tt_manager.clear_table();
+		reload_table.clear();
+		reset_search_stats();
+
+		const uint64_t allocations_before = allocation_count.load(std::memory_order_relaxed);
+		const auto start = std::chrono::steady_clock::now();
+		const auto [action, ev] = position.node.get_best_action();
+		const auto end = std::chrono::steady_clock::now();
+		const double wall_ms = std::chrono::duration<double, std::milli>(end - start).count();
+		result.allocations = allocation_count.load(std::memory_order_relaxed) - allocations_before;
+
+		if (wall_ms < result.wall_ms) {
+			result.action = action;
+			result.ev = ev;
+			result.wall_ms = wall_ms;
+			result.stats = get_search_stats();
+		}
+	}
+	return result;
+}
+
+// Builds the policy of `position`'s load (fastest of `repeat` builds), then times looking up its
+// decisions against solving a sample of them again, and checks that both give the same answers.
+PolicyBenchResult run_policy(const BenchPosition &position, int repeat) {
+	PolicyBenchResult result = {position.name, 0, 0, std::numeric_limits<double>::max(), 0.0, 0.0,
+	                            0};
+	// Kept apart from the global policy, which `get_best_action` would answer from.
+	Policy load_policy;
+
+	for (int i = 0; i < repeat; i++) {
+		tt_manager.clear_table();
+		reload_table.clear();
+		const auto start = std::chrono::steady_clock::now();
+		load_policy.build(position.node);
+		const auto end = std::chrono::steady_clock::now();
+		result.build_ms = std::min(
+		    std::chrono::duration<double, std::milli>(end - start).count(), result.build_ms);
+	}
+	result.decisions = load_policy.get_size();
+	result.file_bytes = load_policy.get_file_size();
+
+	std::vector<Node> decisions;
+	for (std::size_t i = 0; i < load_policy.get_size(); i++) {
+		decisions.push_back(load_policy.get_position(i));
+	}
+	float ev_sum = 0.0f;
+	const auto lookup_start = std::chrono::steady_clock::now();
+	for (std::size_t i = 0; i < POLICY_LOOKUPS; i++) {
+		ev_sum += load_policy.probe(decisions[i % decisions.size()]).value().second;
+	}
+	const auto lookup_end = std::chrono::steady_clock::now();
+	result.lookup_ns =
+	    std::chrono::duration<double, std::nano>(lookup_end - lookup_start).count() /
+	    POLICY_LOOKUPS;
+	// Keeps the lookups from being optimized away.
+	volatile float ev_sink = ev_sum;
+	(void)ev_sink;
+
+	const std::size_t resolved = std::min(decisions.size(), POLICY_RESOLVED_DECISIONS);
+	for (std::size_t i = 0; i < resolved; i++) {
+		const Node &decision = decisions[i * decisions.size() / resolved];
+		tt_manager.clear_table();
+		reload_table.clear();
+		const auto start = std::chrono::steady_clock::now();
+		const auto [action, ev] = decision.get_best_action();
+		const auto end = std::chrono::steady_clock::now();
+		result.resolve_ms += std::chrono::duration<double, std::milli>(end - start).count();
+
+		const auto [planned_action, planned_ev] = load_policy.probe(decision).value();
+		if (action != planned_action || std::abs(ev - planned_ev) > 1e-4f) {
+			std::cout << "[ERROR] '" << position.name << "' plays "
+			          << action_to_str(planned_action) << " with eval " << planned_ev
+			          << " from the policy but the search plays " << action_to_str(action)
+			          << " with eval " << ev << ".\n";
+			result.mismatches++;
+		}
+	}
+	result.resolve_ms /= resolved;
+	return result;
+}
+
+void print_policy_table(const std::vector<PolicyBenchResult> &results) {
+	std::cout << std::left << std::setw(28) << "position" << std::right << std::setw(11)
+	          << "decisions" << std::setw(11) << "bytes" << std::setw(11) << "build ms"
+	          << std::setw(11) << "lookup ns" << std::setw(12) << "re-solve ms" << std::setw(11)
+	          << "speedup" << '\n';
+
+	for (const PolicyBenchResult &result : results) {
+		std::cout << std::left << std::setw(28) << result.name << std::right << std::setw(11)
+		          << result.decisions << std::setw(11) << result.file_bytes << std::fixed
+		          << std::setprecision(2) << std::setw(11) << result.build_ms
+		          << std::setprecision(1) << std::setw(11) << result.lookup_ns
+		          << std::setprecision(3) << std::setw(12) << result.resolve_ms
+		          << std::setprecision(0) << std::setw(10)
+		          << result.resolve_ms * 1e6 / result.lookup_ns << 'x' << '\n';
+	}
+}
+
+double get_tt_hit_rate(const SearchStats &stats) {
+	return stats.tt_probes > 0 ? static_cast<double>(stats.tt_hits) / stats.tt_probes : 0.0;
+}
+
+double get_nodes_per_sec(const BenchResult &result) {
+	return result.wall_ms > 0.0 ? result.stats.nodes_visited / (result.wall_ms / 1000.0) : 0.0;
+}
+
+void print_table(const std::vector<BenchResult> &results) {
+	std::cout << std::left << std::setw(28) << "position" << std::setw(22) << "action"
+	          << std::right << std::setw(11) << "ev" << std::setw(11) << "wall ms" << std::setw(12)
+	          << "nodes" << std::setw(9) << "tt hit" << std::setw(12) << "nodes/s" << std::setw(8)
+	          << "allocs" << '\n';
+
+	for (const BenchResult &result : results) {
+		std::cout << std::left << std::setw(28) << result.name << std::setw(22)
+		          << action_to_str(result.action) << std::right << std::fixed
+		          << std::setprecision(4) << std::setw(11) << result.ev << std::setprecision(2)
+		          << std::setw(11) << result.wall_ms << std::setw(12)
+		          << result.stats.nodes_visited << std::setprecision(1) << std::setw(8)
+		          << get_tt_hit_rate(result.stats) * 100.0 << '%' << std::setprecision(0)
+		          << std::setw(12) << get_nodes_per_sec(result) << std::setw(8)
+		          << result.allocations << '\n';
+	}
+}
+
+// One position per line, so `read_baseline` can parse the file without a JSON library.
+void write_json(std::ostream &out, const std::vector<BenchResult> &results) {
+	out << "{\n  \"positions\": [\n";
+	for (std::size_t i = 0; i < results.size(); i++) {
+		const BenchResult &result = results[i];
+		out << "    {\"name\": \"" << result.name << "\", \"action\": \""
+		    << action_to_str(result.action) << "\", \"ev\": " << std::setprecision(9)
+		    << result.ev << ", \"wall_ms\": " << std::fixed << std::setprecision(3)
+		    << result.wall_ms << std::defaultfloat
+		    << ", \"nodes_visited\": " << result.stats.nodes_visited
+		    << ", \"nodes_expanded\": " << result.stats.nodes_expanded
+		    << ", \"tt_probes\": " << result.stats.tt_probes
+		    << ", \"tt_hits\": " << result.stats.tt_hits
+		    << ", \"tt_hit_rate\": " << std::setprecision(6) << get_tt_hit_rate(result.stats)
+		    << ", \"tt_stores\": " << result.stats.tt_stores
+		    << ", \"tt_evictions\": " << result.stats.tt_evictions
+		    << ", \"nodes_per_sec\": " << std::fixed << std::setprecision(0)
+		    << get_nodes_per_sec(result) << std::defaultfloat
+		    << ", \"allocations\": " << result.allocations << '}'
+		    << (i + 1 < results.size() ? "," : "") << '\n';
+	}
+	out << "  ]\n}\n";
+}
+
+std::optional<std::string> get_json_string(const std::string &line, std::string_view key) {
+	const std::string pattern = "\"" + std::string(key) + "\": \"";
+	const std::size_t start = line.find(pattern);
+	if (start == std::string::npos) {
+		return std::nullopt;
+	}
+	const std::size_t end = line.find('"', start + pattern.size());
+	if (end == std::string::npos) {
+		return std::nullopt;
+	}
+	return line.substr(start + pattern.size(), end - start - pattern.size());
+}
+
+std::optional<double> get_json_number(const std::string &line, std::string_view key) {
+	const std::string pattern = "\"" + std::string(key) + "\": ";
+	const std::size_t start = line.find(pattern);
+	if (start == std::string::npos) {
+		return std::nullopt;
+	}
+	return std::strtod(line.c_str() + start + pattern.size(), nullptr);
+}
+
+std::optional<std::map<std::string, BaselineResult>> read_baseline(const std::string &path) {
+	std::ifstream file(path);
+	if (!file) {
+		return std::nullopt;
+	}
+
+	std::map<std::string, BaselineResult> baseline;
+	std::string line;
+	while (std::getline(file, line)) {
+		const std::optional<std::string> name = get_json_string(line, "name");
+		const std::optional<double> ev = get_json_number(line, "ev");
+		const std::optional<double> wall_ms = get_json_number(line, "wall_ms");
+		const std::optional<double> nodes_visited = get_json_number(line, "nodes_visited");
+		if (name && ev && wall_ms && nodes_visited) {
+			baseline[name.value()] = {ev.value(), wall_ms.value(), nodes_visited.value(),
+			                          get_json_number(line, "allocations")};
+		}
+	}
+	return baseline;
+}
+
+// Prints the change of every position against the baseline. Returns false if any EV differs, any
+// position that is not trivially fast got slower by more than `tolerance_percent`, or any search
+// allocates more than in the baseline. Like `check_steady_state_allocations`, multithreaded runs
+// don't compare allocations, as a worker's task queue may grow when a search splits deeper.
+bool compare_with_baseline(const std::vector<BenchResult> &results,
+                           const std::map<std::string, BaselineResult> &baseline,
+                           int tolerance_percent) {
+	bool passed = true;
+
+	std::cout << '\n'
+	          << std::left << std::setw(28) << "position" << std::right << std::setw(12)
+	          << "base ms" << std::setw(11) << "wall ms" << std::setw(10) << "change"
+	          << std::setw(11) << "nodes" << '\n';
+
+	for (const BenchResult &result : results) {
+		auto match = baseline.find(result.name);
+		if (match == baseline.end()) {
+			std::cout << std::left << std::setw(28) << result.name << " (not in baseline)\n";
+			continue;
+		}
+
+		const BaselineResult &base = match->second;
+		const double change = base.wall_ms > 0.0 ? result.wall_ms / base.wall_ms - 1.0 : 0.0;
+		const double node_change =
+		    base.nodes_visited > 0.0 ? result.stats.nodes_visited / base.nodes_visited - 1.0 : 0.0;
+		const bool ev_matches = std::abs(result.ev - base.ev) <= 1e-4;
+		const bool regressed =
+		    base.wall_ms >= MIN_COMPARED_WALL_MS && change * 100.0 > tolerance_percent;
+		const bool allocates_more = thread_pool.get_thread_count() == 1 && base.allocations &&
+		                            result.allocations > base.allocations.value();
+
+		std::cout << std::left << std::setw(28) << result.name << std::right << std::fixed
+		          << std::setprecision(2) << std::setw(12) << base.wall_ms << std::setw(11)
+		          << result.wall_ms << std::showpos << std::setprecision(1) << std::setw(9)
+		          << change * 100.0 << '%' << std::setw(10) << node_change * 100.0 << '%'
+		          << std::noshowpos << (regressed ? "  REGRESSION" : "")
+		          << (ev_matches ? "" : "  EV MISMATCH")
+		          << (allocates_more ? "  MORE ALLOCATIONS" : "") << '\n';
+
+		if (!ev_matches) {
+			std::cout << "[ERROR] '" << result.name << "' evaluates to " << result.ev
+			          << " but the baseline has " << base.ev << ".\n";
+		}
+		if (allocates_more) {
+			std::cout << "[ERROR] '" << result.name << "' made " << result.allocations
+			          << " allocations but the baseline made " << base.allocations.value() << ".\n";
+		}
+		passed = passed && ev_matches && !regressed && !allocates_more;
+	}
+	return passed;
+}
+
+// Prints every position whose last run allocated. The first run sizes every buffer a search
+// reuses, so with more than one run per position the last one must not allocate at all. With
+// several threads a worker's task queue may still grow when a search splits deeper than any
+// before it, so multithreaded runs are exempt. Returns false if any position allocated.
+bool check_steady_state_allocations(const std::vector<BenchResult> &results, int repeat) {
+	if (repeat < 2 || thread_pool.get_thread_count() > 1) {
+		return true;
+	}
+
+	bool passed = true;
+	for (const BenchResult &result : results) {
+		if (result.allocations > 0) {
+			std::cout << "[ERROR] '" << result.name << "' made " << result.allocations
+			          << " allocations after warming up.\n";
+			passed = false;
+		}
+	}
+	return passed;
+}
+
+void print_usage(std::string_view program_name) {
+	std::cout << "Usage: " << program_name << " [options]\n"
+	          << "Options:\n"
+	          << "  --json              Print results as JSON instead of a table.\n"
+	          << "  --output <path>     Also write the JSON results to <path>.\n"
+	          << "  --compare <path>    Compare against a JSON baseline. Exits with 1 on an EV\n"
+	          << "                      mismatch, a slowdown above the tolerance or more\n"
+	          << "                      allocations than the baseline on one thread.\n"
+	          << "  --tolerance <pct>   Allowed slowdown in percent for --compare (default 10).\n"
+	          << "  --repeat <n>        Runs per position, the fastest is kept (default 3). With\n"
+	          << "                      at least 2 runs on one thread, exits with 1 if the last\n"
+	          << "                      run of any position allocates.\n"
+	          << "  --filter <text>     Only run positions whose name contains <text>.\n"
+	          << "  --policy            Build the policy of each position's load instead, and\n"
+	          << "                      compare looking up its decisions against solving them\n"
+	          << "                      again. Exits with 1 if they disagree.\n"
+	          << "  --threads <n>       Number of search threads (default 1).\n"
+	          << "  --engine <name>     'recursive' (default) or 'retrograde'.\n"
+	          << "  --tt-mb <size>      Transposition table size in megabytes (default "
+	          << DEFAULT_TRANSPOSITION_TABLE_SIZE_MB << ").\n"
+	          << "  --tt-size <bytes>   Transposition table size in bytes, K/M/G suffix allowed.\n"
+	          << "  --tablebase <path>  Endgame tablebase to probe.\n"
+	          << "  --reload-values <path>\n"
+	          << "                      Values of fresh loads to score the end of each load with.\n"
+	          << "  --help              Show this message.\n";
+}
+
+int main(int argc, char **argv) {
+	bool print_json = false;
+	bool bench_policy = false;
+	std::string output_path;
+	std::string baseline_path;
+	std::string filter;
+	int tolerance_percent = 10;
+	int repeat = 3;
+
+	for (int i = 1; i < argc; i++) {
+		std::string_view arg = argv[i];
+		std::optional<int> value;
+
+		if (arg == "--help") {
+			print_usage(argv[0]);
+			return 0;
+		}
+		if (arg == "--json") {
+			print_json = true;
+			continue;
+		}
+		if (arg == "--policy") {
+			bench_policy = true;
+			continue;
+		}
+		if (arg == "--output" && i + 1 < argc) {
+			output_path = argv[++i];
+			continue;
+		}
+		if (arg == "--compare" && i + 1 < argc) {
+			baseline_path = argv[++i];
+			continue;
+		}
+		if (arg == "--filter" && i + 1 < argc) {
+			filter = argv[++i];
+			continue;
+		}
+		if (arg == "--tolerance" && i + 1 < argc) {
+			value = parse_int(argv[++i]);
+			if (!value || value.value() < 0) {
+				std::cout << "[ERROR] Invalid tolerance '" << argv[i] << "'.\n";
+				return 1;
+			}
+			tolerance_percent = value.value();
+			continue;
+		}
+		if (arg == "--repeat" && i + 1 < argc) {
+			value = parse_int(argv[++i]);
+			if (!value || value.value() < 1) {
+				std::cout << "[ERROR] Invalid repeat count '" << argv[i] << "'.\n";
+				return 1;
+			}
+			repeat = value.value();
+			continue;
+		}
+		if (arg == "--threads" && i + 1 < argc) {
+			value = parse_int(argv[++i]);
+			if (!value || value.value() < 1 || value.value() > 256) {
+				std::cout << "[ERROR] Invalid thread count '" << argv[i] << "'.\n";
+				return 1;
+			}
+			thread_pool.resize(value.value());
+			continue;
+		}
+		if (arg == "--engine" && i + 1 < argc) {
+			std::optional<SearchEngine> engine = parse_search_engine(argv[++i]);
+			if (!engine) {
+				std::cout << "[ERROR] Unknown engine '" << argv[i] << "'.\n";
+				return 1;
+			}
+			search_engine = engine.value();
+			continue;
+		}
+		if (arg == "--tt-mb" && i + 1 < argc) {
+			value = parse_int(argv[++i]);
+			if (!value || value.value() < 1) {
+				std::cout << "[ERROR] Invalid transposition table size '" << argv[i] << "'.\n";
+				return 1;
+			}
+			if (!tt_manager.resize(value.value())) {
+				std::cout << "[ERROR] Not enough memory for a transposition table of " << argv[i]
+				          << " MB.\n";
+				return 1;
+			}
+			continue;
+		}
+		if (arg == "--tt-size" && i + 1 < argc) {
+			std::optional<std::size_t> size_bytes = parse_byte_size(argv[++i]);
+			if (!size_bytes || size_bytes.value() == 0) {
+				std::cout << "[ERROR] Invalid transposition table size '" << argv[i] << "'.\n";
+				return 1;
+			}
+			const std::optional<std::size_t> memory_bytes = get_physical_memory_bytes();
+			if (memory_bytes && size_bytes.value() > memory_bytes.value()) {
+				std::cout << "[ERROR] Transposition table size '" << argv[i]
+				          << "' is more than the " << memory_bytes.value()
+				          << " bytes of physical memory.\n";
+				print_usage(argv[0]);
+				return 1;
+			}
+			if (!tt_manager.resize_bytes(size_bytes.value())) {
+				std::cout << "[ERROR] Not enough memory for a transposition table of '" << argv[i]
+				          << "'.\n";
+				return 1;
+			}
+			continue;
+		}
+		if (arg == "--tablebase" && i + 1 < argc) {
+			if (!tablebase.load(argv[++i])) {
+				std::cout << "[ERROR] Failed to load tablebase '" << argv[i] << "'.\n";
+				return 1;
+			}
+			continue;
+		}
+		if (arg == "--reload-values" && i + 1 < argc) {
+			if (!reload_values.load(argv[++i])) {
+				std::cout << "[ERROR] Failed to load reload values '" << argv[i] << "'.\n";
+				return 1;
+			}
+			continue;
+		}
+
+		std::cout << "[ERROR] Unknown option '" << arg << "'.\n";
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (tablebase.is_loaded() &&
+	    tablebase.get_eval_fingerprint() != reload_values.get_fingerprint()) {
+		std::cout << "[ERROR] The tablebase was generated with different reload values.\n";
+		return 1;
+	}
+
+	std::optional<std::map<std::string, BaselineResult>> baseline;
+	if (!baseline_path.empty()) {
+		baseline = read_baseline(baseline_path);
+		if (!baseline) {
+			std::cout << "[ERROR] Failed to read baseline '" << baseline_path << "'.\n";
+			return 1;
+		}
+	}
+
+	if (bench_policy) {
+		std::vector<PolicyBenchResult> policy_results;
+		bool agrees = true;
+		for (const BenchPosition &position : make_corpus()) {
+			if (position.name.find(filter) != std::string::npos) {
+				policy_results.push_back(run_policy(position, repeat));
+				agrees = agrees && policy_results.back().mismatches == 0;
+			}
+		}
+		print_policy_table(policy_results);
+		return agrees ? 0 : 1;
+	}
+
+	std::vector<BenchResult> results;
+	for (const BenchPosition &position : make_corpus()) {
+		if (position.name.find(filter) != std::string::npos) {
+			results.push_back(run_position(position, repeat));
+		}
+	}
+
+	if (print_json) {
+		write_json(std::cout, results);
+	}
+	else {
+		print_table(results);
+	}
+
+	if (!output_path.empty()) {
+		std::ofstream file(output_path);
+		write_json(file, results);
+		if (!file) {
+			std::cout << "[ERROR] Failed to write '" << output_path << "'.\n";
+			return 1;
+		}
+	}
+
+	const bool allocation_free = check_steady_state_allocations(results, repeat);
+	if (baseline && !compare_with_baseline(results, baseline.value(), tolerance_percent)) {
+		return 1;
+	}
+	return allocation_free ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+#include "cli_utils.hpp"
+
+#include <unistd.h>
+
+#include <charconv>
+#include <limits>
+
+std::optional<int> parse_int(std::string_view str) {
+	int value = 0;
+	auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+	if (ec != std::errc() || end != str.data() + str.size()) {
+		return std::nullopt;
+	}
+	return value;
+}
+
+std::optional<std::size_t> parse_byte_size(std::string_view str) {
+	std::size_t shift = 0;
+	if (!str.empty()) {
+		switch (str.back()) {
+			case 'K':
+			case 'k':
+				shift = 10;
+				break;
+			case 'M':
+			case 'm':
+				shift = 20;
+				break;
+			case 'G':
+			case 'g':
+				shift = 30;
+				break;
+			default:
+				break;
+		}
+	}
+	if (shift != 0) {
+		str.remove_suffix(1);
+	}
+
+	std::size_t value = 0;
+	auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), value);
+	if (ec != std::errc() || end != str.data() + str.size() || str.empty() ||
+	    value > (std::numeric_limits<std::size_t>::max() >> shift)) {
+		return std::nullopt;
+	}
+	return value << shift;
+}
+
+std::optional<std::size_t> get_physical_memory_bytes(void) {
+	const long page_count = sysconf(_SC_PHYS_PAGES);
+	const long page_size = sysconf(_SC_PAGESIZE);
+	if (page_count <= 0 || page_size <= 0) {
+		return std::nullopt;
+	}
+	return static_cast<std::size_t>(page_count) * static_cast<std::size_t>(page_size);
+}
+
+std::optional<SearchEngine> parse_search_engine(std::string_view str) {
+	if (str == "recursive") {
+		return SearchEngine::RECURSIVE;
+	}
+	if (str == "retrograde") {
+		return SearchEngine::RETROGRADE;
+	}
+	return std::nullopt;
+}
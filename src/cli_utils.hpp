@@ -0,0 +1,20 @@
+#ifndef CLI_UTILS_HPP
+#define CLI_UTILS_HPP
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+#include "expectimax.hpp"
+
+// Parses a whole string as a decimal integer. Returns nullopt on trailing garbage or overflow.
+std::optional<int> parse_int(std::string_view str);
+// Parses a byte count with an optional K, M or G suffix (powers of 1024), e.g. "512M".
+std::optional<std::size_t> parse_byte_size(std::string_view str);
+// Installed physical memory in bytes, nullopt if the system doesn't tell. Memory budgets above it
+// can never be met and are rejected up front.
+std::optional<std::size_t> get_physical_memory_bytes(void);
+// Parses "recursive" or "retrograde".
+std::optional<SearchEngine> parse_search_engine(std::string_view str);
+
+#endif  // CLI_UTILS_HPP
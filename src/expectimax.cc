@@ -1,602 +1,899 @@
 #include "expectimax.hpp"
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <limits>
 #include <optional>
-
+#include <string>
+
+#include "policy.hpp"
+#include "reload.hpp"
+#include "reload_values.hpp"
+#include "retrograde.hpp"
+#include "search_budget.hpp"
+#include "search_stats.hpp"
+#include "solution_cache.hpp"
+#include "tablebase.hpp"
+#include "thread_pool.hpp"
 #include "transposition_table.hpp"
 
 TranspositionTableManager tt_manager;
+ThreadPool thread_pool;
+Tablebase tablebase;
+SolutionCache solution_cache;
+ReloadTable reload_table;
+ReloadValues reload_values;
+Policy policy;
+SearchEngine search_engine = SearchEngine::RECURSIVE;
+SearchLimits search_limits;
 
 Node::Node(bool is_dealer_turn, bool curr_is_live, bool curr_is_blank, uint8_t live_round_count,
            uint8_t blank_round_count, uint8_t max_lives, uint8_t dealer_lives, uint8_t player_lives,
-           ItemManager dealer_items, ItemManager player_items)
-    : is_dealer_turn(is_dealer_turn),
-      curr_is_live(curr_is_live),
-      curr_is_blank(curr_is_blank),
-      live_round_count(live_round_count),
-      blank_round_count(blank_round_count),
-      max_lives(max_lives),
-      dealer_lives(dealer_lives),
-      player_lives(player_lives),
-      dealer_items(dealer_items),
-      player_items(player_items),
-      handsaw_applied(false),
-      handcuffs_applied(false),
-      handcuffs_available(true) {}
-
-bool Node::operator==(const Node &other) const {
-	return this->dealer_items == other.dealer_items && this->player_items == other.player_items &&
-	       this->live_round_count == other.live_round_count &&
-	       this->blank_round_count == other.blank_round_count &&
-	       this->max_lives == other.max_lives && this->dealer_lives == other.dealer_lives &&
-	       this->player_lives == other.player_lives &&
-	       this->is_dealer_turn == other.is_dealer_turn &&
-	       this->curr_is_live == other.curr_is_live && this->curr_is_blank == other.curr_is_blank &&
-	       this->handsaw_applied == other.handsaw_applied &&
-	       this->handcuffs_applied == other.handcuffs_applied &&
-	       this->handcuffs_available == other.handcuffs_available;
-}
-
-void Node::apply_shoot_dealer_live(void) {
-	assert(this->dealer_lives > 0);
-	assert(this->live_round_count > 0);
-
-	if (this->handsaw_applied || this->dealer_is_fade_charge()) {
-		this->dealer_lives -= dealer_lives == 1 ? 1 : 2;
-	}
-	else {
-		this->dealer_lives--;
-	}
-	this->live_round_count--;
-	this->curr_is_live = false;
-	this->curr_is_blank = false;
-	this->handsaw_applied = false;
-
-	if (this->handcuffs_applied) {
-		this->handcuffs_applied = false;
-		this->handcuffs_available = false;
-	}
-	else {
-		this->is_dealer_turn = !this->is_dealer_turn;
-		this->handcuffs_available = true;
-	}
-}
-
-void Node::apply_shoot_dealer_blank(void) {
-	assert(this->blank_round_count > 0);
-
-	this->blank_round_count--;
-	this->curr_is_live = false;
-	this->curr_is_blank = false;
-	this->handsaw_applied = false;
-
-	if (this->handcuffs_applied) {
-		this->handcuffs_applied = false;
-		this->handcuffs_available = false;
-	}
-	else {
-		this->is_dealer_turn = true;
-		this->handcuffs_available = true;
-	}
+           ItemManager dealer_items, ItemManager player_items) {
+	this->set_dealer_items(dealer_items);
+	this->set_player_items(player_items);
+	this->set_live_round_count(live_round_count);
+	this->set_blank_round_count(blank_round_count);
+	this->set_max_lives(max_lives);
+	this->set_dealer_lives(dealer_lives);
+	this->set_player_lives(player_lives);
+	this->set_dealer_turn(is_dealer_turn);
+	this->set_round_known_live(curr_is_live);
+	this->set_round_known_blank(curr_is_blank);
+	this->set_handcuffs_available(true);
 }
 
 bool Node::player_is_fade_charge(void) const {
-	return this->max_lives == 6 && this->player_lives <= 2;
+	return this->get_max_lives() == 6 && this->get_player_lives() <= 2;
 }
 
 bool Node::dealer_is_fade_charge(void) const {
-	return this->max_lives == 6 && this->dealer_lives <= 2;
+	return this->get_max_lives() == 6 && this->get_dealer_lives() <= 2;
 }
 
-void Node::apply_shoot_player_live(void) {
-	assert(this->player_lives > 0);
-	assert(this->live_round_count > 0);
-
-	if (this->is_dealer_turn && this->dealer_items.has_handsaw() && !this->handsaw_applied) {
-		this->apply_use_handsaw();
-	}
-
-	if (this->handsaw_applied || this->player_is_fade_charge()) {
-		this->player_lives -= this->player_lives == 1 ? 1 : 2;
+void Node::finish_shot(bool live, bool next_is_dealer_turn) {
+	if (live) {
+		this->set_live_round_count(this->get_live_round_count() - 1);
 	}
 	else {
-		this->player_lives--;
+		this->set_blank_round_count(this->get_blank_round_count() - 1);
 	}
+	this->set_round_known_live(false);
+	this->set_round_known_blank(false);
+	this->set_handsaw_applied(false);
 
-	this->live_round_count--;
-	this->curr_is_live = false;
-	this->curr_is_blank = false;
-	this->handsaw_applied = false;
-
-	if (this->handcuffs_applied) {
-		this->handcuffs_applied = false;
-		this->handcuffs_available = false;
+	if (this->is_handcuffs_applied()) {
+		this->set_handcuffs_applied(false);
+		this->set_handcuffs_available(false);
 	}
 	else {
-		this->is_dealer_turn = !this->is_dealer_turn;
-		this->handcuffs_available = true;
+		this->set_dealer_turn(next_is_dealer_turn);
+		this->set_handcuffs_available(true);
 	}
 }
 
-void Node::apply_shoot_player_blank(void) {
-	assert(blank_round_count > 0);
-
-	if (this->is_dealer_turn && this->dealer_items.has_handsaw() && !this->handsaw_applied) {
-		this->apply_use_handsaw();
+template <bool dealer_turn>
+void Node::apply_outcome_on_turn(Outcome outcome) {
+	assert(this->is_dealer_turn() == dealer_turn);
+
+	switch (outcome) {
+		case Outcome::SHOOT_DEALER_LIVE: {
+			assert(this->get_dealer_lives() > 0);
+			assert(this->get_live_round_count() > 0);
+			const int dealer_lives = this->get_dealer_lives();
+			const bool double_damage = this->is_handsaw_applied() || this->dealer_is_fade_charge();
+			this->set_dealer_lives(dealer_lives - (double_damage && dealer_lives > 1 ? 2 : 1));
+			this->finish_shot(true, !dealer_turn);
+			break;
+		}
+		case Outcome::SHOOT_DEALER_BLANK:
+			assert(this->get_blank_round_count() > 0);
+			this->finish_shot(false, true);
+			break;
+		case Outcome::SHOOT_PLAYER_LIVE:
+		case Outcome::SHOOT_PLAYER_BLANK:
+			if constexpr (dealer_turn) {
+				// The dealer always saws off the barrel before shooting the player.
+				if (this->get_dealer_items().has_handsaw() && !this->is_handsaw_applied()) {
+					this->apply_outcome_on_turn<true>(Outcome::USE_HANDSAW);
+				}
+			}
+			if (outcome == Outcome::SHOOT_PLAYER_LIVE) {
+				assert(this->get_player_lives() > 0);
+				assert(this->get_live_round_count() > 0);
+				const int player_lives = this->get_player_lives();
+				const bool double_damage =
+				    this->is_handsaw_applied() || this->player_is_fade_charge();
+				this->set_player_lives(player_lives - (double_damage && player_lives > 1 ? 2 : 1));
+				this->finish_shot(true, !dealer_turn);
+			}
+			else {
+				assert(this->get_blank_round_count() > 0);
+				this->finish_shot(false, false);
+			}
+			break;
+		case Outcome::DRINK_BEER_LIVE:
+			assert(this->get_live_round_count() > 0);
+			this->set_live_round_count(this->get_live_round_count() - 1);
+			this->set_round_known_live(false);
+			this->set_round_known_blank(false);
+			this->remove_mover_item<dealer_turn>(Item::BEER);
+			break;
+		case Outcome::DRINK_BEER_BLANK:
+			assert(this->get_blank_round_count() > 0);
+			this->set_blank_round_count(this->get_blank_round_count() - 1);
+			this->set_round_known_live(false);
+			this->set_round_known_blank(false);
+			this->remove_mover_item<dealer_turn>(Item::BEER);
+			break;
+		case Outcome::SMOKE_CIGARETTE:
+			if constexpr (dealer_turn) {
+				assert(this->get_dealer_lives() < this->get_max_lives());
+				if (!this->dealer_is_fade_charge()) {
+					this->set_dealer_lives(this->get_dealer_lives() + 1);
+				}
+			}
+			else {
+				assert(this->get_player_lives() < this->get_max_lives());
+				assert(!this->player_is_fade_charge());
+				this->set_player_lives(this->get_player_lives() + 1);
+			}
+			this->remove_mover_item<dealer_turn>(Item::CIGARETTE_PACK);
+			break;
+		case Outcome::MAGNIFY_LIVE:
+		case Outcome::MAGNIFY_BLANK:
+			this->set_round_known_live(outcome == Outcome::MAGNIFY_LIVE);
+			this->set_round_known_blank(outcome == Outcome::MAGNIFY_BLANK);
+			this->remove_mover_item<dealer_turn>(Item::MAGNIFYING_GLASS);
+			break;
+		case Outcome::USE_HANDSAW:
+			this->set_handsaw_applied(true);
+			this->remove_mover_item<dealer_turn>(Item::HANDSAW);
+			break;
+		case Outcome::USE_HANDCUFFS:
+			this->set_handcuffs_applied(true);
+			this->remove_mover_item<dealer_turn>(Item::HANDCUFFS);
+			break;
 	}
+}
 
-	this->blank_round_count--;
-	this->curr_is_live = false;
-	this->curr_is_blank = false;
-	this->handsaw_applied = false;
-
-	if (this->handcuffs_applied) {
-		this->handcuffs_applied = false;
-		this->handcuffs_available = false;
+void Node::apply_outcome(Outcome outcome) {
+	if (this->is_dealer_turn()) {
+		this->apply_outcome_on_turn<true>(outcome);
 	}
 	else {
-		this->is_dealer_turn = false;
-		this->handcuffs_available = true;
+		this->apply_outcome_on_turn<false>(outcome);
 	}
 }
 
-void Node::apply_drink_beer_live(void) {
-	assert(this->live_round_count > 0);
+void Node::apply_shoot_dealer_live(void) { this->apply_outcome(Outcome::SHOOT_DEALER_LIVE); }
 
-	this->live_round_count--;
-	this->curr_is_live = false;
-	this->curr_is_blank = false;
+void Node::apply_shoot_dealer_blank(void) { this->apply_outcome(Outcome::SHOOT_DEALER_BLANK); }
 
-	if (this->is_dealer_turn) {
-		this->dealer_items.remove_beer();
-	}
-	else {
-		this->player_items.remove_beer();
-	}
-}
+void Node::apply_shoot_player_live(void) { this->apply_outcome(Outcome::SHOOT_PLAYER_LIVE); }
 
-void Node::apply_drink_beer_blank(void) {
-	assert(this->blank_round_count > 0);
+void Node::apply_shoot_player_blank(void) { this->apply_outcome(Outcome::SHOOT_PLAYER_BLANK); }
 
-	this->blank_round_count--;
-	this->curr_is_live = false;
-	this->curr_is_blank = false;
+void Node::apply_drink_beer_live(void) { this->apply_outcome(Outcome::DRINK_BEER_LIVE); }
 
-	if (this->is_dealer_turn) {
-		this->dealer_items.remove_beer();
-	}
-	else {
-		this->player_items.remove_beer();
-	}
-}
+void Node::apply_drink_beer_blank(void) { this->apply_outcome(Outcome::DRINK_BEER_BLANK); }
 
-void Node::apply_smoke_cigarette(void) {
-	if (this->is_dealer_turn) {
-		assert(this->dealer_lives < this->max_lives);
-		if (!this->dealer_is_fade_charge()) {
-			this->dealer_lives++;
-		}
-		this->dealer_items.remove_cigarette_pack();
-	}
-	else {
-		assert(this->player_lives < this->max_lives);
-		assert(!this->player_is_fade_charge());
-		this->player_lives++;
-		this->player_items.remove_cigarette_pack();
-	}
-}
+void Node::apply_smoke_cigarette(void) { this->apply_outcome(Outcome::SMOKE_CIGARETTE); }
 
-void Node::apply_magnify_live(void) {
-	this->curr_is_live = true;
-	this->curr_is_blank = false;
+void Node::apply_magnify_live(void) { this->apply_outcome(Outcome::MAGNIFY_LIVE); }
 
-	if (this->is_dealer_turn) {
-		this->dealer_items.remove_magnifying_glass();
-	}
-	else {
-		this->player_items.remove_magnifying_glass();
-	}
-}
+void Node::apply_magnify_blank(void) { this->apply_outcome(Outcome::MAGNIFY_BLANK); }
 
-void Node::apply_magnify_blank(void) {
-	this->curr_is_live = false;
-	this->curr_is_blank = true;
+void Node::apply_use_handsaw(void) { this->apply_outcome(Outcome::USE_HANDSAW); }
 
-	if (this->is_dealer_turn) {
-		this->dealer_items.remove_magnifying_glass();
-	}
-	else {
-		this->player_items.remove_magnifying_glass();
-	}
-}
+void Node::apply_use_handcuffs(void) { this->apply_outcome(Outcome::USE_HANDCUFFS); }
 
-void Node::apply_use_handsaw(void) {
-	this->handsaw_applied = true;
+void Node::dealer_remove_magnifying_glass(void) {
+	assert(this->is_dealer_turn());
+	this->remove_mover_item<true>(Item::MAGNIFYING_GLASS);
+}
 
-	if (this->is_dealer_turn) {
-		this->dealer_items.remove_handsaw();
+void Node::add_shoot_dealer(MoveList &moves, float weight) const {
+	if (this->is_only_live_rounds() || this->round_known_live()) {
+		moves.push(Action::SHOOT_DEALER, Outcome::SHOOT_DEALER_LIVE, weight);
+		return;
 	}
-	else {
-		this->player_items.remove_handsaw();
+	if (this->is_only_blank_rounds() || this->round_known_blank()) {
+		moves.push(Action::SHOOT_DEALER, Outcome::SHOOT_DEALER_BLANK, weight);
+		return;
 	}
-}
 
-void Node::apply_use_handcuffs(void) {
-	this->handcuffs_applied = true;
+	const float probability_live = static_cast<float>(this->get_live_round_count()) /
+	                               (this->get_live_round_count() + this->get_blank_round_count());
+	const float probability_blank = 1.0f - probability_live;
+	moves.push(Action::SHOOT_DEALER, Outcome::SHOOT_DEALER_LIVE, probability_live * weight);
+	moves.push(Action::SHOOT_DEALER, Outcome::SHOOT_DEALER_BLANK, probability_blank * weight);
+}
 
-	if (this->is_dealer_turn) {
-		this->dealer_items.remove_handcuffs();
+void Node::add_shoot_player(MoveList &moves, float weight) const {
+	if (this->is_only_live_rounds() || this->round_known_live()) {
+		moves.push(Action::SHOOT_PLAYER, Outcome::SHOOT_PLAYER_LIVE, weight);
+		return;
 	}
-	else {
-		this->player_items.remove_handcuffs();
+	if (this->is_only_blank_rounds() || this->round_known_blank()) {
+		moves.push(Action::SHOOT_PLAYER, Outcome::SHOOT_PLAYER_BLANK, weight);
+		return;
 	}
-}
 
-void Node::dealer_remove_magnifying_glass(void) {
-	assert(this->is_dealer_turn);
-	this->dealer_items.remove_magnifying_glass();
+	const float probability_live = static_cast<float>(this->get_live_round_count()) /
+	                               (this->get_live_round_count() + this->get_blank_round_count());
+	const float probability_blank = 1.0f - probability_live;
+	moves.push(Action::SHOOT_PLAYER, Outcome::SHOOT_PLAYER_LIVE, probability_live * weight);
+	moves.push(Action::SHOOT_PLAYER, Outcome::SHOOT_PLAYER_BLANK, probability_blank * weight);
 }
 
-std::array<Node, 4> Node::get_states_after_shoot(void) const {
-	Node shoot_dealer_live = *this;
-	Node shoot_player_live = *this;
-	Node shoot_dealer_blank = *this;
-	Node shoot_player_blank = *this;
-
-	if (this->live_round_count > 0 && this->dealer_lives > 0) {
-		shoot_dealer_live.apply_shoot_dealer_live();
-	}
-	if (this->live_round_count > 0 && this->player_lives > 0) {
-		shoot_player_live.apply_shoot_player_live();
+void Node::add_drink_beer(MoveList &moves, float weight) const {
+	if (this->is_only_live_rounds() || this->round_known_live()) {
+		moves.push(Action::DRINK_BEER, Outcome::DRINK_BEER_LIVE, weight);
+		return;
 	}
-	if (this->blank_round_count > 0) {
-		shoot_dealer_blank.apply_shoot_dealer_blank();
-		shoot_player_blank.apply_shoot_player_blank();
+	if (this->is_only_blank_rounds() || this->round_known_blank()) {
+		moves.push(Action::DRINK_BEER, Outcome::DRINK_BEER_BLANK, weight);
+		return;
 	}
 
-	return {shoot_player_blank, shoot_player_live, shoot_dealer_blank, shoot_dealer_live};
+	const float probability_live = static_cast<float>(this->get_live_round_count()) /
+	                               (this->get_live_round_count() + this->get_blank_round_count());
+	const float probability_blank = 1.0f - probability_live;
+	moves.push(Action::DRINK_BEER, Outcome::DRINK_BEER_LIVE, probability_live * weight);
+	moves.push(Action::DRINK_BEER, Outcome::DRINK_BEER_BLANK, probability_blank * weight);
 }
 
-float Node::calc_drink_beer_ev(float item_pickup_probability) const {
-	const float probability_live = static_cast<float>(this->live_round_count) /
-	                               (this->live_round_count + this->blank_round_count);
-	const float probability_blank = 1.0f - probability_live;
+void Node::add_smoke_cigarette(MoveList &moves, float weight) const {
+	moves.push(Action::SMOKE_CIGARETTE, Outcome::SMOKE_CIGARETTE, weight);
+}
 
-	Node eject_live = *this;
-	Node eject_blank = *this;
+void Node::add_use_magnifying_glass(MoveList &moves, float weight) const {
+	assert(!this->round_known_live() && !this->round_known_blank());
 
-	if (this->is_only_live_rounds() || this->curr_is_live) {
-		eject_live.apply_drink_beer_live();
-		return eject_live.expectimax() * item_pickup_probability;
+	if (this->is_only_live_rounds()) {
+		moves.push(Action::USE_MAGNIFYING_GLASS, Outcome::MAGNIFY_LIVE, weight);
+		return;
 	}
-	if (this->is_only_blank_rounds() || this->curr_is_blank) {
-		eject_blank.apply_drink_beer_blank();
-		return eject_blank.expectimax() * item_pickup_probability;
+	if (this->is_only_blank_rounds()) {
+		moves.push(Action::USE_MAGNIFYING_GLASS, Outcome::MAGNIFY_BLANK, weight);
+		return;
 	}
 
-	eject_live.apply_drink_beer_live();
-	eject_blank.apply_drink_beer_blank();
-
-	return eject_live.expectimax() * probability_live * item_pickup_probability +
-	       eject_blank.expectimax() * probability_blank * item_pickup_probability;
+	const float probability_live = static_cast<float>(this->get_live_round_count()) /
+	                               (this->get_live_round_count() + this->get_blank_round_count());
+	const float probability_blank = 1.0f - probability_live;
+	moves.push(Action::USE_MAGNIFYING_GLASS, Outcome::MAGNIFY_LIVE, probability_live * weight);
+	moves.push(Action::USE_MAGNIFYING_GLASS, Outcome::MAGNIFY_BLANK, probability_blank * weight);
 }
 
-float Node::calc_smoke_cigarette_ev(float item_pickup_probability) const {
-	Node smoked = *this;
-	smoked.apply_smoke_cigarette();
-	return smoked.expectimax() * item_pickup_probability;
+void Node::add_use_handsaw(MoveList &moves, float weight) const {
+	moves.push(Action::USE_HANDSAW, Outcome::USE_HANDSAW, weight);
 }
 
-float Node::calc_use_magnifying_glass_ev(float item_pickup_probability) const {
-	const float probability_live = static_cast<float>(this->live_round_count) /
-	                               (this->live_round_count + this->blank_round_count);
-	const float probability_blank = 1.0f - probability_live;
+void Node::add_use_handcuffs(MoveList &moves, float weight) const {
+	moves.push(Action::USE_HANDCUFFS, Outcome::USE_HANDCUFFS, weight);
+}
 
-	Node magnify_live = *this;
-	Node magnify_blank = *this;
+template <bool dealer_turn>
+Node Node::get_successor(Outcome outcome) const {
+	SEARCH_STATS_INCREMENT(successor_copies);
+	Node successor = *this;
+	successor.apply_outcome_on_turn<dealer_turn>(outcome);
+	return successor;
+}
 
-	assert(!this->curr_is_live && !this->curr_is_blank);
+void Node::add_use_items(MoveList &moves, uint32_t item_mask, float weight) const {
+	for (; item_mask != 0; item_mask &= item_mask - 1) {
+		switch (static_cast<Item>(__builtin_ctz(item_mask))) {
+			case Item::MAGNIFYING_GLASS:
+				this->add_use_magnifying_glass(moves, weight);
+				break;
+			case Item::CIGARETTE_PACK:
+				this->add_smoke_cigarette(moves, weight);
+				break;
+			case Item::BEER:
+				this->add_drink_beer(moves, weight);
+				break;
+			case Item::HANDSAW:
+				this->add_use_handsaw(moves, weight);
+				break;
+			case Item::HANDCUFFS:
+				this->add_use_handcuffs(moves, weight);
+				break;
+		}
+	}
+}
 
-	if (this->is_only_live_rounds()) {
-		magnify_live.apply_magnify_live();
-		return magnify_live.expectimax() * item_pickup_probability;
+namespace {
+uint32_t get_item_bit(Item item, bool usable) {
+	return static_cast<uint32_t>(usable) << static_cast<int>(item);
+}
+}  // namespace
+
+void Node::generate_player_moves(MoveList &moves) const {
+	const bool round_known = this->round_known_live() || this->round_known_blank();
+	const bool can_eject_live = !this->round_known_blank() && !this->is_only_blank_rounds();
+
+	// Items the player may use in this state, masked by the items actually held.
+	const uint32_t usable_items =
+	    get_item_bit(Item::MAGNIFYING_GLASS, !round_known && !this->is_only_live_rounds() &&
+	                                             !this->is_only_blank_rounds()) |
+	    get_item_bit(Item::CIGARETTE_PACK, !this->player_is_fade_charge() &&
+	                                           this->get_player_lives() != this->get_max_lives()) |
+	    get_item_bit(Item::BEER, can_eject_live) |
+	    get_item_bit(Item::HANDSAW, can_eject_live && !this->is_handsaw_applied()) |
+	    get_item_bit(Item::HANDCUFFS, this->is_handcuffs_available() &&
+	                                      !this->is_handcuffs_applied() && !this->is_last_round());
+	this->add_use_items(moves, usable_items & this->get_player_items().get_available_mask(), 1.0f);
+
+	// Shooting into a known round only makes sense one way.
+	if (this->is_only_live_rounds() || this->round_known_live()) {
+		this->add_shoot_dealer(moves, 1.0f);
+	}
+	else if (this->is_only_blank_rounds() || this->round_known_blank()) {
+		this->add_shoot_player(moves, 1.0f);
 	}
-	if (this->is_only_blank_rounds()) {
-		magnify_blank.apply_magnify_blank();
-		return magnify_blank.expectimax() * item_pickup_probability;
+	else {
+		this->add_shoot_dealer(moves, 1.0f);
+		this->add_shoot_player(moves, 1.0f);
 	}
-
-	magnify_live.apply_magnify_live();
-	magnify_blank.apply_magnify_blank();
-
-	return magnify_live.expectimax() * probability_live * item_pickup_probability +
-	       magnify_blank.expectimax() * probability_blank * item_pickup_probability;
 }
 
-float Node::calc_use_handsaw_ev(float item_pickup_probability) const {
-	Node applied_handsaw = *this;
-	applied_handsaw.apply_use_handsaw();
-	return applied_handsaw.expectimax() * item_pickup_probability;
-}
+void Node::generate_dealer_moves(MoveList &moves) const {
+	/*
+	 * The dealer AI acts as follows:
+	 * - It always knows the last round type and acts accordingly.
+	 * - If it doesn't know the currect round type, it flips a coin.
+	 * - Before shooting, it iterates through his items in the order they spawned (we assume the
+	 * order is random) and decides if he wants to use them.
+	 * Item usages:
+	 * - Beer: If its not the last round and he the known round (if known) isn't live.
+	 * - Cigarettes: If the dealer's health is not full.
+	 * - Magnifying Glass: If he doesn't already know the current round and it isn't the last
+	 * one.
+	 * - Handsaw: If the dealer knows that the current round is live and he hasn't already used
+	 * a handsaw. He also uses a handsaw if he decides to shoot the player.
+	 * - Handcuffs: If the player is not already handcuffed and it's not the last round.
+	 */
+	const ItemManager dealer_items = this->get_dealer_items();
+	const int dealer_item_count = dealer_items.get_item_count();
+
+	if (dealer_item_count > 0) {
+		const bool round_known = this->round_known_live() || this->round_known_blank();
+		const uint32_t usable_items =
+		    get_item_bit(Item::MAGNIFYING_GLASS, !round_known && !this->is_last_round()) |
+		    get_item_bit(Item::CIGARETTE_PACK, this->get_dealer_lives() != this->get_max_lives()) |
+		    get_item_bit(Item::BEER, !this->round_known_live() && !this->is_last_round()) |
+		    get_item_bit(Item::HANDSAW, this->round_known_live() && !this->is_handsaw_applied()) |
+		    get_item_bit(Item::HANDCUFFS, this->is_handcuffs_available() &&
+		                                      !this->is_handcuffs_applied() &&
+		                                      !this->is_last_round());
+		this->add_use_items(moves, usable_items & dealer_items.get_available_mask(),
+		                    1.0f / dealer_item_count);
+
+		if (moves.size() > 0) {
+			return;
+		}
+	}
 
-float Node::calc_use_handcuffs_ev(float item_pickup_probability) const {
-	Node applied_handcuffs = *this;
-	applied_handcuffs.apply_use_handcuffs();
-	return applied_handcuffs.expectimax() * item_pickup_probability;
+	if (this->is_last_round()) {
+		if (this->get_live_round_count() == 1) {
+			this->add_shoot_player(moves, 1.0f);
+		}
+		else {
+			this->add_shoot_dealer(moves, 1.0f);
+		}
+	}
+	else if (this->round_known_live()) {
+		this->add_shoot_player(moves, 1.0f);
+	}
+	else if (this->round_known_blank()) {
+		this->add_shoot_dealer(moves, 1.0f);
+	}
+	else {
+		this->add_shoot_dealer(moves, 0.5f);
+		this->add_shoot_player(moves, 0.5f);
+	}
 }
 
 bool Node::is_only_live_rounds(void) const {
-	return this->live_round_count > 0 && this->blank_round_count == 0;
+	return this->get_live_round_count() > 0 && this->get_blank_round_count() == 0;
 }
 
 bool Node::is_only_blank_rounds(void) const {
-	return this->blank_round_count > 0 && this->live_round_count == 0;
+	return this->get_blank_round_count() > 0 && this->get_live_round_count() == 0;
 }
 
 bool Node::is_last_round(void) const {
-	return (this->live_round_count + this->blank_round_count) == 1;
+	return (this->get_live_round_count() + this->get_blank_round_count()) == 1;
 }
 
 bool Node::is_terminal(void) const {
-	return this->dealer_lives == 0 || this->player_lives == 0 ||
-	       (this->live_round_count + this->blank_round_count) == 0;
+	return this->get_dealer_lives() == 0 || this->get_player_lives() == 0 ||
+	       ((this->get_live_round_count() + this->get_blank_round_count()) == 0 &&
+	        this->get_reloads_left() == 0);
 }
 
-float Node::eval(void) const {
-	if (dealer_lives == 0) {
-		return 100;
-	}
-	else if (player_lives == 0) {
-		return -100;
-	}
-	return (this->player_lives - this->dealer_lives) * 10;
+namespace {
+// Nodes with fewer plies than this left below them are searched on the calling thread, as their
+// subtrees are too small to pay for the tasks.
+constexpr int MIN_SPLIT_PLIES = 10;
+}  // namespace
+
+bool Node::is_split_point(int depth) const {
+	return thread_pool.get_thread_count() > 1 &&
+	       std::min(depth, this->get_depth_bound()) >= MIN_SPLIT_PLIES;
 }
 
-float Node::expectimax(void) const {
-	if (this->is_terminal()) {
-		return this->eval();
-	}
+int Node::get_depth_bound(void) const {
+	return this->get_reloads_left() > 0 ? UNLIMITED_DEPTH : this->get_load_depth_bound();
+}
 
-	if (std::optional<float> ev = tt_manager.get_ev(*this)) {
-		return ev.value();
-	}
+int Node::get_load_depth_bound(void) const {
+	// Every ply fires or ejects a shell or uses an item other than beer. Either side uses at
+	// most one magnifying glass per shell and one handsaw and one handcuffs per shot, and only
+	// smokes to undo lives lost, at most two per live shell from now on.
+	const int live = this->get_live_round_count();
+	const int shells = live + this->get_blank_round_count();
+	const auto get_item_bound = [&](ItemManager items, int lives) {
+		items.limit(Item::BEER, 0);
+		items.limit(Item::MAGNIFYING_GLASS, shells);
+		items.limit(Item::HANDSAW, shells);
+		items.limit(Item::HANDCUFFS, shells);
+		items.limit(Item::CIGARETTE_PACK, this->get_max_lives() - lives + 2 * live);
+		return items.get_item_count();
+	};
+	return shells + get_item_bound(this->get_dealer_items(), this->get_dealer_lives()) +
+	       get_item_bound(this->get_player_items(), this->get_player_lives());
+}
 
-	const float probability_live = static_cast<float>(this->live_round_count) /
-	                               (this->live_round_count + this->blank_round_count);
-	const float probability_blank = 1.0f - probability_live;
-	auto [shoot_player_blank, shoot_player_live, shoot_dealer_blank, shoot_dealer_live] =
-	    this->get_states_after_shoot();
-
-	if (this->is_dealer_turn) {
-		const int dealer_item_count = this->dealer_items.get_item_count();
-		const float item_pickup_probability =
-		    dealer_item_count > 0 ? 1.0f / dealer_item_count : 0.0f;
-		/*
-		 * The dealer AI acts as follows:
-		 * - It always knows the last round type and acts accordingly.
-		 * - If it doesn't know the currect round type, it flips a coin.
-		 * - Before shooting, it iterates through his items in the order they spawned (we assume the
-		 * order is random) and decides if he wants to use them.
-		 * Item usages:
-		 * - Beer: If its not the last round and he the known round (if known) isn't live.
-		 * - Cigarettes: If the dealer's health is not full.
-		 * - Magnifying Glass: If he doesn't already know the current round and it isn't the last
-		 * one.
-		 * - Handsaw: If the dealer knows that the current round is live and he hasn't already used
-		 * a handsaw. He also uses a handsaw if he decides to shoot the player.
-		 * - Handcuffs: If the player is not already handcuffed and it's not the last round.
-		 */
-
-		if (dealer_item_count > 0) {
-			bool chose_item = false;
-			float ev_after_item_usage = 0.0f;
-
-			if (this->dealer_items.has_beer() && !this->curr_is_live && !this->is_last_round()) {
-				ev_after_item_usage += this->calc_drink_beer_ev(item_pickup_probability);
-				chose_item = true;
-			}
-			if (this->dealer_items.has_cigarette_pack() && this->dealer_lives != this->max_lives) {
-				ev_after_item_usage += this->calc_smoke_cigarette_ev(item_pickup_probability);
-				chose_item = true;
-			}
-			if (this->dealer_items.has_magnifying_glass() && !this->curr_is_live &&
-			    !this->curr_is_blank && !this->is_last_round()) {
-				ev_after_item_usage += this->calc_use_magnifying_glass_ev(item_pickup_probability);
-				chose_item = true;
-			}
-			if (this->dealer_items.has_handsaw() && !this->handsaw_applied && this->curr_is_live) {
-				ev_after_item_usage += this->calc_use_handsaw_ev(item_pickup_probability);
-				chose_item = true;
-			}
-			if (this->dealer_items.has_handcuffs() && this->handcuffs_available &&
-			    !this->handcuffs_applied && !this->is_last_round()) {
-				ev_after_item_usage += this->calc_use_handcuffs_ev(item_pickup_probability);
-				chose_item = true;
-			}
+float Node::get_max_ev(void) const {
+	// Later loads, and fresh loads scored by the reload values, can end any way.
+	if (this->get_reloads_left() > 0 || reload_values.is_loaded()) {
+		return MAX_EV;
+	}
 
-			if (chose_item) {
-				tt_manager.add_node(*this, ev_after_item_usage);
-				return ev_after_item_usage;
-			}
-		}
+	// The dealer loses at most two lives per live shell, and the player can smoke back up to
+	// the maximum. Lives are only scored once the load is over.
+	const int dealer_lives = this->get_dealer_lives() - 2 * this->get_live_round_count();
+	if (dealer_lives <= 0) {
+		return MAX_EV;
+	}
+	const int player_lives =
+	    std::min(this->get_max_lives(),
+	             this->get_player_lives() + this->get_player_items().get_cigarette_pack_count());
+	// A dealer node whose usable items don't account for all of the dealer's items has less
+	// than full weight, which pulls its EV towards zero.
+	return std::max((player_lives - dealer_lives) * 10, 0);
+}
 
-		if (this->is_last_round()) {
-			if (this->live_round_count == 1) {
-				return shoot_player_live.eval();
-			}
+bool Node::is_reload_pending(void) const {
+	return this->get_dealer_lives() > 0 && this->get_player_lives() > 0 &&
+	       (this->get_live_round_count() + this->get_blank_round_count()) == 0 &&
+	       this->get_reloads_left() > 0;
+}
 
-			return shoot_dealer_blank.eval();
+float Node::eval(void) const {
+	if (this->get_dealer_lives() == 0) {
+		return 100;
+	}
+	else if (this->get_player_lives() == 0) {
+		return -100;
+	}
+	// The reload values hold fresh loads, so they only score a load that has run out. A horizon
+	// node of a limited search still has shells left and keeps the life difference.
+	if (this->get_live_round_count() + this->get_blank_round_count() == 0 &&
+	    reload_values.is_loaded()) {
+		if (std::optional<float> ev = reload_values.probe(*this)) {
+			return ev.value();
 		}
+		SEARCH_STATS_INCREMENT(reload_value_misses);
+	}
+	return (this->get_player_lives() - this->get_dealer_lives()) * 10;
+}
 
-		if (this->curr_is_live) {
-			const float ev = shoot_player_live.expectimax();
-			tt_manager.add_node(*this, ev);
-			return ev;
+template <bool dealer_turn>
+Node Node::get_canonical_on_turn(void) const {
+	Node canonical = *this;
+	const int live = this->get_live_round_count();
+	const int blank = this->get_blank_round_count();
+	const int shells = live + blank;
+
+	// No items are picked up during a load, so without cuffs on the table the flag is never read
+	// again before the next shot overwrites it.
+	if (!this->get_player_items().has_handcuffs() && !this->get_dealer_items().has_handcuffs()) {
+		canonical.set_handcuffs_available(true);
+	}
+
+	// Every beer and handsaw use takes a shell, a magnifying glass needs a new unknown shell
+	// and handcuffs need a shot in between, so the player can't use more of them than there are
+	// shells left. Smoking can at most undo the missing lives plus two per live shell. The
+	// dealer's counts can't be limited, as they set the chance of the dealer picking each item.
+	// Items left over carry into the next load, so none of this holds with reloads left or with
+	// reload values scoring the items held at the end of the load.
+	if (this->get_reloads_left() == 0 && !reload_values.is_loaded()) {
+		ItemManager player_items = this->get_player_items();
+		player_items.limit(Item::MAGNIFYING_GLASS, shells);
+		player_items.limit(Item::BEER, shells);
+		player_items.limit(Item::HANDSAW, shells);
+		player_items.limit(Item::HANDCUFFS, shells);
+		player_items.limit(Item::CIGARETTE_PACK,
+		                   this->get_max_lives() - this->get_player_lives() + 2 * live);
+		canonical.set_player_items(player_items);
+	}
+
+	// With one shell kind left the player's moves don't depend on knowing it, and a handsaw on a
+	// blank is cleared by the shot without effect. The dealer's do: it only uses a magnifying
+	// glass on unknown rounds, and the shot uses up a handsaw if none is applied yet.
+	if constexpr (!dealer_turn) {
+		if (live == 0) {
+			canonical.set_round_known_blank(false);
+			canonical.set_handsaw_applied(false);
 		}
-
-		if (this->curr_is_blank) {
-			const float ev = shoot_dealer_blank.expectimax();
-			tt_manager.add_node(*this, ev);
-			return ev;
+		if (blank == 0) {
+			canonical.set_round_known_live(false);
 		}
+	}
+	return canonical;
+}
 
-		if (this->is_only_live_rounds()) {
-			const float ev =
-			    shoot_dealer_live.expectimax() * 0.5f + shoot_player_live.expectimax() * 0.5f;
-			tt_manager.add_node(*this, ev);
-			return ev;
-		}
+Node Node::get_canonical(void) const {
+	if (this->is_dealer_turn()) {
+		return this->get_canonical_on_turn<true>();
+	}
+	return this->get_canonical_on_turn<false>();
+}
 
-		if (this->is_only_blank_rounds()) {
-			const float ev =
-			    shoot_dealer_blank.expectimax() * 0.5f + shoot_player_blank.expectimax() * 0.5f;
-			tt_manager.add_node(*this, ev);
-			return ev;
-		}
+float Node::expectimax(void) const { return this->expectimax(UNLIMITED_DEPTH, MIN_EV); }
 
-		const float ev = shoot_dealer_live.expectimax() * probability_live * 0.5f +
-		                 shoot_dealer_blank.expectimax() * probability_blank * 0.5f +
-		                 shoot_player_live.expectimax() * probability_live * 0.5f +
-		                 shoot_player_blank.expectimax() * probability_blank * 0.5f;
-		tt_manager.add_node(*this, ev);
-		return ev;
+float Node::expectimax(int depth, float alpha) const {
+	// Equivalent states are folded onto one canonical state before the lookups, so they share
+	// tablebase and transposition table entries.
+	if (this->is_dealer_turn()) {
+		return this->get_canonical_on_turn<true>().expectimax_on_turn<true>(depth, alpha);
 	}
+	return this->get_canonical_on_turn<false>().expectimax_on_turn<false>(depth, alpha);
+}
 
-	float best_ev = std::numeric_limits<float>::lowest();
+template <bool dealer_turn>
+float Node::expectimax_on_turn(int depth, float alpha) const {
+	SearchPlyScope ply_scope;
 
-	if (this->player_items.has_beer() && !this->curr_is_blank && !this->is_only_blank_rounds()) {
-		best_ev = std::max(this->calc_drink_beer_ev(1.0f), best_ev);
+	if (this->is_terminal()) {
+		SEARCH_STATS_INCREMENT(terminal_nodes);
+		return this->eval();
 	}
-	if (this->player_items.has_cigarette_pack() && !this->player_is_fade_charge() &&
-	    this->player_lives != this->max_lives) {
-		best_ev = std::max(this->calc_smoke_cigarette_ev(1.0f), best_ev);
+
+	const float max_ev = this->get_max_ev();
+	if (alpha >= max_ev) {
+		SEARCH_STATS_INCREMENT(max_ev_cutoffs);
+		return max_ev;
 	}
-	if (this->player_items.has_magnifying_glass() && !this->curr_is_live && !this->curr_is_blank &&
-	    !this->is_only_live_rounds() && !this->is_only_blank_rounds()) {
-		best_ev = std::max(this->calc_use_magnifying_glass_ev(1.0f), best_ev);
+
+	// A subtree that ends within the depth left is solved exactly, so that it shares exact
+	// transposition table entries with unlimited searches.
+	if (depth < UNLIMITED_DEPTH && depth >= this->get_depth_bound()) {
+		depth = UNLIMITED_DEPTH;
 	}
-	if (this->player_items.has_handsaw() && !this->handsaw_applied &&
-	    !this->is_only_blank_rounds() && !this->curr_is_blank) {
-		best_ev = std::max(this->calc_use_handsaw_ev(1.0f), best_ev);
+
+	if (this->is_reload_pending() && depth == UNLIMITED_DEPTH) {
+		return reload_table.get_value(*this);
 	}
-	if (this->player_items.has_handcuffs() && this->handcuffs_available &&
-	    !this->handcuffs_applied && !this->is_last_round()) {
-		best_ev = std::max(this->calc_use_handcuffs_ev(1.0f), best_ev);
+
+	if (std::optional<float> ev = tablebase.probe(*this)) {
+		SEARCH_STATS_INCREMENT(tablebase_hits);
+		return ev.value();
 	}
 
-	if (this->is_only_live_rounds() || this->curr_is_live) {
-		best_ev = std::max(shoot_dealer_live.expectimax(), best_ev);
+	// The depth limit, or a reload that a limited search doesn't look past.
+	if (depth == 0 || this->is_reload_pending()) {
+		SEARCH_STATS_INCREMENT(horizon_nodes);
+		return this->eval();
 	}
-	else if (this->is_only_blank_rounds() || this->curr_is_blank) {
-		best_ev = std::max(shoot_player_blank.expectimax(), best_ev);
+
+	std::optional<Action> best_action;
+	if (std::optional<float> ev = tt_manager.get_ev(*this, depth, alpha, best_action)) {
+		return ev.value();
 	}
-	else {
-		best_ev = std::max(shoot_dealer_live.expectimax() * probability_live +
-		                       shoot_dealer_blank.expectimax() * probability_blank,
-		                   best_ev);
-		best_ev = std::max(shoot_player_live.expectimax() * probability_live +
-		                       shoot_player_blank.expectimax() * probability_blank,
-		                   best_ev);
+
+	SearchBudget *budget = thread_search_budget;
+	if (budget != nullptr && budget->charge_node()) {
+		return 0.0f;
 	}
 
-	tt_manager.add_node(*this, best_ev);
-	return best_ev;
-}
+	SEARCH_STATS_INCREMENT(nodes_expanded);
 
-bool Node::round_known_live(void) const { return this->curr_is_live; }
+	const int child_depth = depth == UNLIMITED_DEPTH ? UNLIMITED_DEPTH : depth - 1;
 
-bool Node::round_known_blank(void) const { return this->curr_is_blank; }
+	MoveList moves;
+	float ev;
 
-ItemManager Node::get_dealer_items(void) const { return this->dealer_items; }
+	if constexpr (dealer_turn) {
+		SEARCH_STATS_INCREMENT(chance_nodes);
+		this->generate_dealer_moves(moves);
+		ev = this->search_chance<true>(moves, 0, moves.size(), child_depth, alpha, max_ev,
+		                               this->is_split_point(depth));
+	}
+	else {
+		// Each action is a chance node over its outcomes. Once one action is searched, the
+		// others only matter if they beat it, so the action that was best when the state was
+		// last searched goes first.
+		SEARCH_STATS_INCREMENT(decision_nodes);
+		this->generate_player_moves(moves);
+
+		std::array<int, ACTION_COUNT + 1> action_begins;
+		int action_count = 0;
+		int first_action = 0;
+		for (int i = 0; i < moves.size(); i++) {
+			if (i == 0 || moves[i].action != moves[i - 1].action) {
+				if (moves[i].action == best_action) {
+					first_action = action_count;
+				}
+				action_begins[action_count++] = i;
+			}
+		}
+		action_begins[action_count] = moves.size();
+
+		const auto get_action_index = [&](int n) {
+			return n == 0 ? first_action : n - (n <= first_action);
+		};
+		// Only the first action is searched before the node is split, as it sets the window
+		// for the others (young brothers wait).
+		const bool split_point = this->is_split_point(depth);
+		const bool split = split_point && action_count > 2;
+
+		ev = std::numeric_limits<float>::lowest();
+		best_action.reset();
+		for (int n = 0; n < (split ? 1 : action_count); n++) {
+			const int index = get_action_index(n);
+			const Action action = moves[action_begins[index]].action;
+
+			// The stored best action only orders later searches. Ties are settled by the root,
+			// which searches every action with a full window.
+			const float action_ev = this->search_chance<false>(
+			    moves, action_begins[index], action_begins[index + 1], child_depth,
+			    std::max(alpha, ev), max_ev, split_point);
+			if (action_ev > ev) {
+				ev = action_ev;
+				best_action = action;
+			}
+		}
 
-ItemManager Node::get_player_items(void) const { return this->player_items; }
+		if (split) {
+			// The other actions are searched in parallel against the first one's EV. They miss
+			// the tighter windows they would get from each other in turn, which only decide
+			// where a search may stop with a bound, so exact EVs stay the same.
+			std::array<float, ACTION_COUNT> action_evs;
+			const float action_alpha = std::max(alpha, ev);
+			const int ply = get_search_ply();
+			thread_pool.parallel_for(action_count - 1, [&](int n) {
+				SearchTaskScope task_scope(ply);
+				SearchBudgetScope budget_scope(budget);
+				const int index = get_action_index(n + 1);
+				action_evs[n] = this->search_chance<false>(moves, action_begins[index],
+				                                           action_begins[index + 1], child_depth,
+				                                           action_alpha, max_ev, false);
+			});
+			for (int n = 0; n < action_count - 1; n++) {
+				if (action_evs[n] > ev) {
+					ev = action_evs[n];
+					best_action = moves[action_begins[get_action_index(n + 1)]].action;
+				}
+			}
+		}
+	}
 
-bool Node::is_player_turn(void) const { return !this->is_dealer_turn; }
+	// A search whose budget ran out returns garbage, which must not outlive it.
+	if (budget == nullptr || !budget->is_spent()) {
+		tt_manager.add_node(*this, ev, depth,
+		                    ev > alpha || alpha <= MIN_EV ? EvBound::EXACT : EvBound::UPPER,
+		                    best_action);
+	}
+	return ev;
+}
 
-int Node::get_live_round_count(void) { return this->live_round_count; }
+template <bool dealer_turn>
+float Node::search_chance(const MoveList &moves, int begin, int end, int child_depth,
+                          float alpha, float max_ev, bool split) const {
+	// Without a window there is nothing to prune, so the successors are independent and can be
+	// solved in parallel. They are summed in the same order as below, which keeps the EV
+	// bitwise equal.
+	if (split && alpha <= MIN_EV && end - begin > 1) {
+		std::array<float, MAX_SUCCESSORS> child_evs;
+		SearchBudget *budget = thread_search_budget;
+		const int ply = get_search_ply();
+		thread_pool.parallel_for(end - begin, [&](int i) {
+			SearchTaskScope task_scope(ply);
+			SearchBudgetScope budget_scope(budget);
+			child_evs[i] = this->get_successor<dealer_turn>(moves[begin + i].outcome)
+			                   .expectimax(child_depth, MIN_EV);
+		});
+
+		float ev = 0.0f;
+		for (int i = begin; i < end; i++) {
+			ev += child_evs[i - begin] * moves[i].probability;
+		}
+		return ev;
+	}
 
-int Node::get_blank_round_count(void) { return this->blank_round_count; }
+	float remaining_probability = 0.0f;
+	for (int i = begin; i < end; i++) {
+		remaining_probability += moves[i].probability;
+	}
 
-int Node::get_dealer_lives(void) { return this->dealer_lives; }
+	float ev = 0.0f;
+	for (int i = begin; i < end; i++) {
+		const float probability = moves[i].probability;
+		remaining_probability = std::max(remaining_probability - probability, 0.0f);
 
-int Node::get_player_lives(void) { return this->player_lives; }
+		// The EV this successor must beat for the node to beat `alpha`, with all the successors
+		// after it at `max_ev`.
+		float child_alpha = MIN_EV;
+		if (alpha > MIN_EV) {
+			child_alpha = std::max(
+			    (alpha - ev - remaining_probability * max_ev) / probability, MIN_EV);
+		}
 
-std::pair<Action, float> Node::get_best_action(void) const {
-	tt_manager.clear_table();
-	Action best_action = Action::SHOOT_DEALER;
+		const Node child = this->get_successor<dealer_turn>(moves[i].outcome);
+		const float child_ev = child.expectimax(child_depth, child_alpha);
+		ev += child_ev * probability;
+		if (child_alpha > MIN_EV && child_ev <= child_alpha) {
+			SEARCH_STATS_INCREMENT(chance_cutoffs);
+			return std::min(ev + remaining_probability * max_ev, alpha);
+		}
+	}
+	return ev;
+}
 
-	float shoot_player_ev = std::numeric_limits<float>::lowest();
-	float shoot_dealer_ev = std::numeric_limits<float>::lowest();
-	float best_item_ev = std::numeric_limits<float>::lowest();
+std::string action_to_str(Action action) {
+	switch (action) {
+		case Action::SHOOT_DEALER:
+			return "shoot dealer";
+		case Action::SHOOT_PLAYER:
+			return "shoot player";
+		case Action::DRINK_BEER:
+			return "drink beer";
+		case Action::SMOKE_CIGARETTE:
+			return "smoke cigarette pack";
+		case Action::USE_MAGNIFYING_GLASS:
+			return "use magnifying glass";
+		case Action::USE_HANDSAW:
+			return "use handsaw";
+		case Action::USE_HANDCUFFS:
+			return "use handcuffs";
+		default:
+			assert(false);
+			return "";
+	}
+}
 
-	const float probability_live = static_cast<float>(this->live_round_count) /
-	                               (this->live_round_count + this->blank_round_count);
-	const float probability_blank = 1.0f - probability_live;
-	auto [shoot_player_blank, shoot_player_live, shoot_dealer_blank, shoot_dealer_live] =
-	    this->get_states_after_shoot();
-
-	if (this->player_items.has_beer() && !this->curr_is_blank && !this->is_only_blank_rounds()) {
-		const float ev = this->calc_drink_beer_ev(1.0f);
-		if (ev > best_item_ev) {
-			best_item_ev = ev;
-			best_action = Action::DRINK_BEER;
-		}
+ActionValues Node::get_action_values(void) const {
+	assert(!this->is_dealer_turn());
+
+	const ActionValues action_values = search_engine == SearchEngine::RETROGRADE
+	                                       ? solve_retrograde(*this)
+	                                       : this->search_action_values();
+	if (action_values.is_exact()) {
+		const auto [action, ev] = action_values.front();
+		solution_cache.store(*this, action, ev);
+		tt_manager.add_node(this->get_canonical_on_turn<false>(), ev, UNLIMITED_DEPTH,
+		                    EvBound::EXACT, action);
 	}
-	if (this->player_items.has_cigarette_pack() && !this->player_is_fade_charge() &&
-	    this->player_lives != this->max_lives) {
-		const float ev = this->calc_smoke_cigarette_ev(1.0f);
-		if (ev > best_item_ev) {
-			best_item_ev = ev;
-			best_action = Action::SMOKE_CIGARETTE;
+	return action_values;
+}
+
+ActionValues Node::search_action_values(void) const {
+	tt_manager.new_search();
+
+	MoveList moves;
+	this->generate_player_moves(moves);
+
+	if (!search_limits.is_limited()) {
+		return this->search_root(moves, UNLIMITED_DEPTH, nullptr);
+	}
+
+	// Iterative deepening: each iteration searches one ply deeper, reusing the entries of the
+	// previous ones, until an iteration is exact or the budget runs out mid-iteration. A one-ply
+	// search only scores the successors with `eval`, so it runs outside the budget and always
+	// leaves an answer to fall back on.
+	SearchBudget budget(search_limits);
+	ActionValues action_values = this->search_root(moves, 0, nullptr);
+	action_values.set_depth(1);
+	const int load_depth = this->get_load_depth_bound();
+	uint64_t last_iteration_nodes = 0;
+	bool horizon_saturated = false;
+
+	for (int depth = 2; !action_values.is_exact(); depth++) {
+		// Past the end of the load only reloads are left, which a limited search doesn't look
+		// into, so the last iteration is unlimited.
+		const bool exact = depth >= load_depth || horizon_saturated;
+		const uint64_t start_node_count = budget.get_node_count();
+		const ActionValues iteration =
+		    this->search_root(moves, exact ? UNLIMITED_DEPTH : depth - 1, &budget);
+		if (budget.is_spent()) {
+			SEARCH_STATS_INCREMENT(budget_stops);
+			break;
 		}
-	}
-	if (this->player_items.has_magnifying_glass() && !this->curr_is_live && !this->curr_is_blank &&
-	    !this->is_only_live_rounds() && !this->is_only_blank_rounds()) {
-		const float ev = this->calc_use_magnifying_glass_ev(1.0f);
-		if (ev > best_item_ev) {
-			best_item_ev = ev;
-			best_action = Action::USE_MAGNIFYING_GLASS;
+		SEARCH_STATS_INCREMENT(deepening_iterations);
+		action_values = iteration;
+		action_values.set_depth(exact ? UNLIMITED_DEPTH : depth);
+
+		// Without pruning, an iteration that grows little over the one before shows that the
+		// horizon hardly cuts the tree any more. Every deeper iteration would cost about as much
+		// as the exact search, so that is the next one.
+		const uint64_t iteration_nodes = budget.get_node_count() - start_node_count;
+		horizon_saturated =
+		    last_iteration_nodes > 0 && 2 * iteration_nodes < 3 * last_iteration_nodes;
+		last_iteration_nodes = iteration_nodes;
+	}
+	return action_values;
+}
+
+ActionValues Node::search_root(const MoveList &moves, int child_depth,
+                               SearchBudget *budget) const {
+	// Every successor at the root is an independent subtree. They are solved as one parallel
+	// batch and then combined into the action EVs.
+	std::array<float, MAX_SUCCESSORS> successor_evs;
+	thread_pool.parallel_for(moves.size(), [&](int i) {
+		SearchTaskScope task_scope(0);
+		SearchBudgetScope budget_scope(budget);
+		ActionTimer action_timer(moves[i].action);
+		successor_evs[i] =
+		    this->get_successor<false>(moves[i].outcome).expectimax(child_depth, MIN_EV);
+	});
+
+	return rank_action_values(moves, successor_evs);
+}
+
+ActionValues Node::rank_action_values(
+    const MoveList &moves, const std::array<float, MAX_SUCCESSORS> &successor_evs) {
+	std::array<float, ACTION_COUNT> action_evs;
+	std::array<bool, ACTION_COUNT> action_available = {};
+	action_evs.fill(std::numeric_limits<float>::lowest());
+
+	for (int i = 0; i < moves.size(); i++) {
+		const int action_index = static_cast<int>(moves[i].action);
+		if (!action_available[action_index]) {
+			action_available[action_index] = true;
+			action_evs[action_index] = 0.0f;
 		}
+		action_evs[action_index] += successor_evs[i] * moves[i].probability;
 	}
-	if (this->player_items.has_handsaw() && !this->handsaw_applied &&
-	    !this->is_only_blank_rounds() && !this->curr_is_blank) {
-		const float ev = this->calc_use_handsaw_ev(1.0f);
-		if (ev > best_item_ev) {
-			best_item_ev = ev;
-			best_action = Action::USE_HANDSAW;
+
+	// Insertion sort by EV, which keeps ties in enum order: shooting the dealer, shooting
+	// yourself, then the items. There are at most ACTION_COUNT entries, and unlike
+	// std::stable_sort it needs no temporary buffer.
+	std::array<int, ACTION_COUNT> ranked;
+	int ranked_count = 0;
+	for (int action_index = 0; action_index < ACTION_COUNT; action_index++) {
+		if (!action_available[action_index]) {
+			continue;
 		}
-	}
-	if (this->player_items.has_handcuffs() && this->handcuffs_available &&
-	    !this->handcuffs_applied && !this->is_last_round()) {
-		const float ev = this->calc_use_handcuffs_ev(1.0f);
-		if (ev > best_item_ev) {
-			best_item_ev = ev;
-			best_action = Action::USE_HANDCUFFS;
+		int position = ranked_count++;
+		for (; position > 0 && action_evs[ranked[position - 1]] < action_evs[action_index];
+		     position--) {
+			ranked[position] = ranked[position - 1];
 		}
+		ranked[position] = action_index;
 	}
 
-	if (this->is_only_live_rounds() || this->curr_is_live) {
-		shoot_dealer_ev = shoot_dealer_live.expectimax();
-	}
-	else if (this->is_only_blank_rounds() || this->curr_is_blank) {
-		shoot_player_ev = shoot_player_blank.expectimax();
-	}
-	else {
-		shoot_dealer_ev = shoot_dealer_live.expectimax() * probability_live +
-		                  shoot_dealer_blank.expectimax() * probability_blank;
-		shoot_player_ev = shoot_player_live.expectimax() * probability_live +
-		                  shoot_player_blank.expectimax() * probability_blank;
+	ActionValues action_values;
+	for (int i = 0; i < ranked_count; i++) {
+		action_values.push(static_cast<Action>(ranked[i]), action_evs[ranked[i]]);
 	}
+	return action_values;
+}
 
-	if (shoot_dealer_ev >= shoot_player_ev && shoot_dealer_ev >= best_item_ev) {
-		return std::pair<Action, float>(Action::SHOOT_DEALER, shoot_dealer_ev);
+std::pair<Action, float> Node::get_best_action(void) const {
+	if (std::optional<std::pair<Action, float>> planned = policy.probe(*this)) {
+		SEARCH_STATS_INCREMENT(policy_hits);
+		return planned.value();
 	}
-
-	if (shoot_player_ev > shoot_dealer_ev && shoot_player_ev >= best_item_ev) {
-		return std::pair<Action, float>(Action::SHOOT_PLAYER, shoot_player_ev);
+	if (std::optional<std::pair<Action, float>> cached = solution_cache.probe(*this)) {
+		SEARCH_STATS_INCREMENT(solution_cache_hits);
+		return cached.value();
 	}
-
-	return std::pair<Action, float>(best_action, best_item_ev);
+	return this->get_action_values().front();
 }
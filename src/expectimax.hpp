@@ -1,7 +1,10 @@
 #ifndef EXPECTIMAX_HPP
 #define EXPECTIMAX_HPP
+#include <array>
+#include <cassert>
 #include <cstdint>
 #include <functional>
+#include <string>
 #include <utility>
 
 #include "item_manager.hpp"
@@ -16,6 +19,53 @@ enum class Action {
 	USE_HANDCUFFS,
 };
 
+constexpr int ACTION_COUNT = 7;
+
+// How root positions are solved. The recursive engine is a depth-first expectimax over the
+// transposition table; the retrograde engine enumerates the reachable states and evaluates them
+// bottom-up (see retrograde.hpp). Both return the same EVs.
+enum class SearchEngine {
+	RECURSIVE,
+	RETROGRADE,
+};
+
+extern SearchEngine search_engine;
+
+// The ways a move can resolve. Shots, beer and the magnifying glass depend on the chambered round.
+enum class Outcome : uint8_t {
+	SHOOT_DEALER_LIVE,
+	SHOOT_DEALER_BLANK,
+	SHOOT_PLAYER_LIVE,
+	SHOOT_PLAYER_BLANK,
+	DRINK_BEER_LIVE,
+	DRINK_BEER_BLANK,
+	SMOKE_CIGARETTE,
+	MAGNIFY_LIVE,
+	MAGNIFY_BLANK,
+	USE_HANDSAW,
+	USE_HANDCUFFS,
+};
+
+std::string action_to_str(Action action);
+
+// Loads after the current one that a node can look into.
+constexpr int MAX_RELOADS = 3;
+
+// Search depth in plies that never cuts a line short. Also the draft of exact transposition
+// table entries.
+constexpr int UNLIMITED_DEPTH = 255;
+
+// Every EV lies within these bounds: a won game scores MAX_EV and a lost one MIN_EV.
+constexpr float MIN_EV = -100.0f;
+constexpr float MAX_EV = 100.0f;
+
+// Player: beer (2) + cigarettes + magnifying glass (2) + handsaw + handcuffs + both shots (4).
+constexpr int MAX_SUCCESSORS = 11;
+
+class MoveList;
+class ActionValues;
+class SearchBudget;
+
 class Node final {
    public:
 	explicit Node(bool is_dealer_turn, bool curr_is_live, bool curr_is_blank,
@@ -23,8 +73,16 @@ class Node final {
 	              uint8_t dealer_lives, uint8_t player_lives, ItemManager dealer_items,
 	              ItemManager player_items);
 
+	// Answered from the loaded policy or the solution cache when either holds the position.
 	std::pair<Action, float> get_best_action(void) const;
+	// EVs of all legal player actions from a single search, best first. The first entry is
+	// always the one `get_best_action` returns. Always searches, and stores the best action in
+	// the solution cache unless a search budget cut the search short.
+	ActionValues get_action_values(void) const;
+	// The game is decided, or the shotgun is empty with no reloads left to look past.
 	bool is_terminal(void) const;
+	// The shotgun is empty and the next load is evaluated as a chance node (see reload.hpp).
+	bool is_reload_pending(void) const;
 	void apply_shoot_dealer_live(void);
 	void apply_shoot_dealer_blank(void);
 	void apply_shoot_player_live(void);
@@ -39,48 +97,232 @@ class Node final {
 	void dealer_remove_magnifying_glass(void);
 	bool is_only_live_rounds(void) const;
 	bool is_only_blank_rounds(void) const;
-	bool round_known_live(void) const;
-	bool round_known_blank(void) const;
-	bool is_player_turn(void) const;
-	ItemManager get_dealer_items(void) const;
-	ItemManager get_player_items(void) const;
-	int get_live_round_count(void);
-	int get_blank_round_count(void);
-	int get_dealer_lives(void);
-	int get_player_lives(void);
-
-	bool operator==(const Node &other) const;
+
+	bool round_known_live(void) const { return this->get_field(CURR_IS_LIVE_SHIFT, 1); }
+	bool round_known_blank(void) const { return this->get_field(CURR_IS_BLANK_SHIFT, 1); }
+	bool is_player_turn(void) const { return !this->is_dealer_turn(); }
+	ItemManager get_dealer_items(void) const {
+		return ItemManager::from_bits(this->get_field(DEALER_ITEMS_SHIFT, ITEMS_WIDTH));
+	}
+	ItemManager get_player_items(void) const {
+		return ItemManager::from_bits(this->get_field(PLAYER_ITEMS_SHIFT, ITEMS_WIDTH));
+	}
+	int get_live_round_count(void) const { return this->get_field(LIVE_ROUNDS_SHIFT, 4); }
+	int get_blank_round_count(void) const { return this->get_field(BLANK_ROUNDS_SHIFT, 4); }
+	int get_dealer_lives(void) const { return this->get_field(DEALER_LIVES_SHIFT, 3); }
+	int get_player_lives(void) const { return this->get_field(PLAYER_LIVES_SHIFT, 3); }
+	// Loads after the current one that the search looks into. With none left, the position at
+	// the end of the load is scored by `eval`.
+	int get_reloads_left(void) const { return this->get_field(RELOADS_LEFT_SHIFT, 2); }
+	void set_reloads_left(int reloads) {
+		assert(reloads >= 0 && reloads <= MAX_RELOADS);
+		this->set_field(RELOADS_LEFT_SHIFT, 2, reloads);
+	}
+
+	bool operator==(const Node &other) const { return this->state == other.state; }
 
    private:
+	// The whole node is packed into `state` (LSB first):
+	//   0-19: dealer items, 20-39: player items (see ItemManager)
+	//   40-43: live round count, 44-47: blank round count
+	//   48-49: max lives tier (max lives / 2 - 1), 50-52: dealer lives, 53-55: player lives
+	//   56: dealer's turn, 57: current round known live, 58: current round known blank,
+	//   59: handsaw applied, 60: handcuffs applied, 61: handcuffs available
+	//   62-63: reloads left
+	// Every state has exactly one encoding, so the word is also the transposition table key and
+	// equality is a single compare.
+	static constexpr int DEALER_ITEMS_SHIFT = 0;
+	static constexpr int PLAYER_ITEMS_SHIFT = 20;
+	static constexpr int ITEMS_WIDTH = 20;
+	static constexpr int LIVE_ROUNDS_SHIFT = 40;
+	static constexpr int BLANK_ROUNDS_SHIFT = 44;
+	static constexpr int MAX_LIVES_TIER_SHIFT = 48;
+	static constexpr int DEALER_LIVES_SHIFT = 50;
+	static constexpr int PLAYER_LIVES_SHIFT = 53;
+	static constexpr int DEALER_TURN_SHIFT = 56;
+	static constexpr int CURR_IS_LIVE_SHIFT = 57;
+	static constexpr int CURR_IS_BLANK_SHIFT = 58;
+	static constexpr int HANDSAW_APPLIED_SHIFT = 59;
+	static constexpr int HANDCUFFS_APPLIED_SHIFT = 60;
+	static constexpr int HANDCUFFS_AVAILABLE_SHIFT = 61;
+	static constexpr int RELOADS_LEFT_SHIFT = 62;
+
+	uint32_t get_field(int shift, int width) const {
+		return static_cast<uint32_t>(this->state >> shift & ((uint64_t{1} << width) - 1));
+	}
+	void set_field(int shift, int width, uint64_t value) {
+		const uint64_t mask = ((uint64_t{1} << width) - 1) << shift;
+		this->state = (this->state & ~mask) | (value << shift & mask);
+	}
+
+	int get_max_lives(void) const { return 2 * (this->get_field(MAX_LIVES_TIER_SHIFT, 2) + 1); }
+	void set_max_lives(int max_lives) {
+		assert(max_lives == 2 || max_lives == 4 || max_lives == 6);
+		this->set_field(MAX_LIVES_TIER_SHIFT, 2, max_lives / 2 - 1);
+	}
+	bool is_dealer_turn(void) const { return this->get_field(DEALER_TURN_SHIFT, 1); }
+	bool is_handsaw_applied(void) const { return this->get_field(HANDSAW_APPLIED_SHIFT, 1); }
+	bool is_handcuffs_applied(void) const { return this->get_field(HANDCUFFS_APPLIED_SHIFT, 1); }
+	bool is_handcuffs_available(void) const {
+		return this->get_field(HANDCUFFS_AVAILABLE_SHIFT, 1);
+	}
+
+	// Removes one `item` from the side to move with a single subtraction on the state word.
+	template <bool dealer_turn>
+	void remove_mover_item(Item item) {
+		constexpr int shift = dealer_turn ? DEALER_ITEMS_SHIFT : PLAYER_ITEMS_SHIFT;
+		assert(ItemManager::from_bits(this->get_field(shift, ITEMS_WIDTH)).has(item));
+		this->state -= static_cast<uint64_t>(ItemManager::get_unit(item)) << shift;
+	}
+
+	void set_dealer_items(ItemManager items) {
+		this->set_field(DEALER_ITEMS_SHIFT, ITEMS_WIDTH, items.to_bits());
+	}
+	void set_player_items(ItemManager items) {
+		this->set_field(PLAYER_ITEMS_SHIFT, ITEMS_WIDTH, items.to_bits());
+	}
+	void set_live_round_count(int count) { this->set_field(LIVE_ROUNDS_SHIFT, 4, count); }
+	void set_blank_round_count(int count) { this->set_field(BLANK_ROUNDS_SHIFT, 4, count); }
+	void set_dealer_lives(int lives) { this->set_field(DEALER_LIVES_SHIFT, 3, lives); }
+	void set_player_lives(int lives) { this->set_field(PLAYER_LIVES_SHIFT, 3, lives); }
+	void set_dealer_turn(bool value) { this->set_field(DEALER_TURN_SHIFT, 1, value); }
+	void set_round_known_live(bool value) { this->set_field(CURR_IS_LIVE_SHIFT, 1, value); }
+	void set_round_known_blank(bool value) { this->set_field(CURR_IS_BLANK_SHIFT, 1, value); }
+	void set_handsaw_applied(bool value) { this->set_field(HANDSAW_APPLIED_SHIFT, 1, value); }
+	void set_handcuffs_applied(bool value) { this->set_field(HANDCUFFS_APPLIED_SHIFT, 1, value); }
+	void set_handcuffs_available(bool value) {
+		this->set_field(HANDCUFFS_AVAILABLE_SHIFT, 1, value);
+	}
+
+	// Moves that change whose turn it is take the side to move as a template parameter, so the
+	// per-side branches are resolved at compile time. The untemplated versions dispatch on the
+	// stored turn once.
+	//
+	// `depth` is the number of plies left to search. A node reached with none left is scored by
+	// `eval`, and a node whose subtree can't be that deep is solved exactly.
+	//
+	// `alpha` is the EV the caller needs the node to beat. Only the player maximizes and the
+	// dealer is a chance node, so there is no upper end to the window. If the EV can't beat
+	// `alpha`, the search may stop early and return an upper bound no greater than `alpha`;
+	// otherwise it returns the EV. With `alpha` at MIN_EV the EV is always exact.
 	float expectimax(void) const;
+	float expectimax(int depth, float alpha) const;
+	template <bool dealer_turn>
+	float expectimax_on_turn(int depth, float alpha) const;
+	// EV of the chance node over the successors in `moves` from `begin` to `end`. Stops with an
+	// upper bound once the successors searched so far show the EV can't beat `alpha`, even if
+	// all the others scored `max_ev` (Star1 pruning). With `split` and no window to prune with,
+	// the successors are solved in parallel on the thread pool.
+	template <bool dealer_turn>
+	float search_chance(const MoveList &moves, int begin, int end, int child_depth, float alpha,
+	                    float max_ev, bool split) const;
+	// Whether the node, searched `depth` plies deep, roots a subtree big enough to spread over
+	// the thread pool.
+	bool is_split_point(int depth) const;
+	// Highest EV of any position the search can reach from this one, so also an upper bound on
+	// its own EV and on the EVs of its successors.
+	float get_max_ev(void) const;
+	// Most plies left until the current load ends, and until the last load ends, which is
+	// UNLIMITED_DEPTH with reloads left.
+	int get_load_depth_bound(void) const;
+	int get_depth_bound(void) const;
+	void apply_outcome(Outcome outcome);
+	template <bool dealer_turn>
+	void apply_outcome_on_turn(Outcome outcome);
+	void finish_shot(bool live, bool next_is_dealer_turn);
+	template <bool dealer_turn>
+	Node get_successor(Outcome outcome) const;
+	Node get_canonical(void) const;
+	template <bool dealer_turn>
+	Node get_canonical_on_turn(void) const;
+	// Root search of the recursive engine. Without search limits it is solved exactly, otherwise
+	// by iterative deepening within the budget.
+	ActionValues search_action_values(void) const;
+	// Searches the root successors in `moves` to `child_depth` plies in parallel.
+	ActionValues search_root(const MoveList &moves, int child_depth, SearchBudget *budget) const;
+	// Combines the EVs of the root successors in `moves` into ranked action values.
+	static ActionValues rank_action_values(
+	    const MoveList &moves, const std::array<float, MAX_SUCCESSORS> &successor_evs);
 	float eval(void) const;
 	bool is_last_round(void) const;
-	std::array<Node, 4> get_states_after_shoot(void) const;
-	float calc_drink_beer_ev(float item_pickup_probability) const;
-	float calc_smoke_cigarette_ev(float item_pickup_probability) const;
-	float calc_use_magnifying_glass_ev(float item_pickup_probability) const;
-	float calc_use_handsaw_ev(float item_pickup_probability) const;
-	float calc_use_handcuffs_ev(float item_pickup_probability) const;
+	void generate_player_moves(MoveList &moves) const;
+	void generate_dealer_moves(MoveList &moves) const;
+	void add_shoot_dealer(MoveList &moves, float weight) const;
+	void add_shoot_player(MoveList &moves, float weight) const;
+	void add_drink_beer(MoveList &moves, float weight) const;
+	void add_smoke_cigarette(MoveList &moves, float weight) const;
+	void add_use_magnifying_glass(MoveList &moves, float weight) const;
+	void add_use_handsaw(MoveList &moves, float weight) const;
+	void add_use_handcuffs(MoveList &moves, float weight) const;
+	void add_use_items(MoveList &moves, uint32_t item_mask, float weight) const;
 	bool player_is_fade_charge(void) const;
 	bool dealer_is_fade_charge(void) const;
 
 	friend struct std::hash<Node>;
+	friend class Tablebase;
+	friend class RetrogradeSolver;
+	friend class ReloadTable;
+	friend class ReloadValues;
+	friend class Policy;
+
+	uint64_t state = 0;
+};
+
+static_assert(sizeof(Node) == sizeof(uint64_t), "a node must stay a single register-sized word");
+
+// One outcome of a move and the probability of reaching it. The resulting state is only built by
+// `Node::get_successor` when the search descends into it.
+struct Successor {
+	Action action;
+	Outcome outcome;
+	float probability;
+};
+
+// Every successor of a node, in a fixed-size buffer so that move generation never allocates. The
+// outcomes of one action are adjacent. For the player the probabilities of each action's outcomes
+// sum to 1; for the dealer they also include the dealer AI's chance of choosing the action, so the
+// EV of a dealer node is the probability-weighted sum over the whole list.
+class MoveList final {
+   public:
+	void push(Action action, Outcome outcome, float probability) {
+		assert(this->count < MAX_SUCCESSORS);
+		this->successors[this->count++] = {action, outcome, probability};
+	}
 
-	ItemManager dealer_items;
-	ItemManager player_items;
-
-	uint8_t live_round_count : 4;
-	uint8_t blank_round_count : 4;
-	uint8_t max_lives : 3;
-	uint8_t dealer_lives : 3;
-	uint8_t player_lives : 3;
-
-	bool is_dealer_turn : 1;
-	bool curr_is_live : 1;
-	bool curr_is_blank : 1;
-	bool handsaw_applied : 1;
-	bool handcuffs_applied : 1;
-	bool handcuffs_available : 1;
+	int size(void) const { return this->count; }
+	const Successor &operator[](int index) const { return this->successors[index]; }
+	const Successor *begin(void) const { return this->successors.data(); }
+	const Successor *end(void) const { return this->successors.data() + this->count; }
+
+   private:
+	std::array<Successor, MAX_SUCCESSORS> successors;
+	int count = 0;
+};
+
+// The EVs of the legal player actions at the root, in a fixed-size buffer so that a search
+// returns its result without allocating, and the depth of the search they come from.
+class ActionValues final {
+   public:
+	// Plies searched from the root, UNLIMITED_DEPTH for exact values.
+	int get_depth(void) const { return this->depth; }
+	void set_depth(int depth) { this->depth = depth; }
+	bool is_exact(void) const { return this->depth == UNLIMITED_DEPTH; }
+
+	void push(Action action, float ev) {
+		assert(this->count < ACTION_COUNT);
+		this->values[this->count++] = {action, ev};
+	}
+
+	int size(void) const { return this->count; }
+	const std::pair<Action, float> &operator[](int index) const { return this->values[index]; }
+	const std::pair<Action, float> &front(void) const { return this->values[0]; }
+	const std::pair<Action, float> *begin(void) const { return this->values.data(); }
+	const std::pair<Action, float> *end(void) const { return this->values.data() + this->count; }
+
+   private:
+	std::array<std::pair<Action, float>, ACTION_COUNT> values;
+	int count = 0;
+	int depth = UNLIMITED_DEPTH;
 };
 
 #endif
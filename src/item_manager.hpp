@@ -1,11 +1,23 @@
 #ifndef ITEM_MANAGER_HPP
 #define ITEM_MANAGER_HPP
+#include <cassert>
 #include <cstddef>
 #include <cstdint>
-#include <functional>
 
-class Node;
+// Item kinds in the order of their nibbles in ItemManager, which is also the bit order of
+// `ItemManager::get_available_mask`.
+enum class Item : uint8_t {
+	MAGNIFYING_GLASS,
+	CIGARETTE_PACK,
+	BEER,
+	HANDSAW,
+	HANDCUFFS,
+};
+
+constexpr int ITEM_KIND_COUNT = 5;
 
+// Item counts packed as one nibble per kind (see Item), so that every operation is a few
+// arithmetic instructions on a single word without branches.
 class ItemManager final {
    public:
 	explicit ItemManager(int magnifying_glass_count, int cigarette_pack_count, int beer_count,
@@ -17,37 +29,83 @@ class ItemManager final {
 	ItemManager(ItemManager &&) = default;
 	ItemManager &operator=(const ItemManager &) = default;
 	ItemManager &operator=(ItemManager &&) = default;
-	bool operator==(const ItemManager &other) const;
-
-	bool has_magnifying_glass(void) const;
-	bool has_cigarette_pack(void) const;
-	bool has_beer(void) const;
-	bool has_handsaw(void) const;
-	bool has_handcuffs(void) const;
-
-	uint8_t get_magnifying_glass_count(void) const;
-	uint8_t get_cigarette_pack_count(void) const;
-	uint8_t get_beer_count(void) const;
-	uint8_t get_handsaw_count(void) const;
-	uint8_t get_handcuffs_count(void) const;
-
-	void remove_magnifying_glass(void);
-	void remove_cigarette_pack(void);
-	void remove_beer(void);
-	void remove_handsaw(void);
-	void remove_handcuffs(void);
-
-	void add_magnifying_glass(void);
-	void add_cigarette_pack(void);
-	void add_beer(void);
-	void add_handsaw(void);
-	void add_handcuffs(void);
-
-	int get_item_count(void) const;
+	bool operator==(const ItemManager &other) const { return this->items == other.items; }
 
-   private:
-	friend struct std::hash<Node>;
+	// The value that adds one item of `item` to the packed counts.
+	static constexpr uint32_t get_unit(Item item) {
+		return uint32_t{1} << (4 * static_cast<int>(item));
+	}
+
+	bool has(Item item) const { return this->get_count(item) > 0; }
+	uint8_t get_count(Item item) const {
+		return static_cast<uint8_t>(this->items >> (4 * static_cast<int>(item)) & 0xF);
+	}
+	void add(Item item) {
+		assert(this->get_count(item) < 8);
+		this->items += get_unit(item);
+	}
+	void remove(Item item) {
+		assert(this->get_count(item) > 0);
+		this->items -= get_unit(item);
+	}
+	// Lowers the count of `item` to at most `max_count`.
+	void limit(Item item, int max_count) {
+		const int count = this->get_count(item);
+		if (count > max_count) {
+			this->items -= (count - max_count) * get_unit(item);
+		}
+	}
+
+	// Bit `i` is set if at least one item of kind `i` is held. Adding 7 to the low three bits
+	// of each nibble carries into the nibble's top bit exactly when one of them is set.
+	uint32_t get_available_mask(void) const {
+		const uint32_t nonzero = (((this->items & 0x77777) + 0x77777) | this->items) & 0x88888;
+		return (nonzero >> 3 & 0x1) | (nonzero >> 6 & 0x2) | (nonzero >> 9 & 0x4) |
+		       (nonzero >> 12 & 0x8) | (nonzero >> 15 & 0x10);
+	}
+
+	// Horizontal nibble sum: pairs of nibbles are added into bytes, then a multiply adds the
+	// three bytes into the top one.
+	int get_item_count(void) const {
+		const uint32_t pairs = (this->items & 0x0F0F0F) + (this->items >> 4 & 0x0F0F0F);
+		return static_cast<int>((pairs * 0x010101) >> 16 & 0xFF);
+	}
 
+	bool has_magnifying_glass(void) const { return this->has(Item::MAGNIFYING_GLASS); }
+	bool has_cigarette_pack(void) const { return this->has(Item::CIGARETTE_PACK); }
+	bool has_beer(void) const { return this->has(Item::BEER); }
+	bool has_handsaw(void) const { return this->has(Item::HANDSAW); }
+	bool has_handcuffs(void) const { return this->has(Item::HANDCUFFS); }
+
+	uint8_t get_magnifying_glass_count(void) const {
+		return this->get_count(Item::MAGNIFYING_GLASS);
+	}
+	uint8_t get_cigarette_pack_count(void) const { return this->get_count(Item::CIGARETTE_PACK); }
+	uint8_t get_beer_count(void) const { return this->get_count(Item::BEER); }
+	uint8_t get_handsaw_count(void) const { return this->get_count(Item::HANDSAW); }
+	uint8_t get_handcuffs_count(void) const { return this->get_count(Item::HANDCUFFS); }
+
+	void remove_magnifying_glass(void) { this->remove(Item::MAGNIFYING_GLASS); }
+	void remove_cigarette_pack(void) { this->remove(Item::CIGARETTE_PACK); }
+	void remove_beer(void) { this->remove(Item::BEER); }
+	void remove_handsaw(void) { this->remove(Item::HANDSAW); }
+	void remove_handcuffs(void) { this->remove(Item::HANDCUFFS); }
+
+	void add_magnifying_glass(void) { this->add(Item::MAGNIFYING_GLASS); }
+	void add_cigarette_pack(void) { this->add(Item::CIGARETTE_PACK); }
+	void add_beer(void) { this->add(Item::BEER); }
+	void add_handsaw(void) { this->add(Item::HANDSAW); }
+	void add_handcuffs(void) { this->add(Item::HANDCUFFS); }
+
+	// The packed counts, used by Node to store item sets inside its own state word.
+	static ItemManager from_bits(uint32_t items) {
+		ItemManager item_manager;
+		item_manager.items = items;
+		return item_manager;
+	}
+	uint32_t to_bits(void) const { return this->items; }
+
+   private:
 	uint32_t items = 0;
 };
 #endif  // ITEM_MANAGER_HPP
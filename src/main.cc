@@ -1,12 +1,27 @@
 #include <cassert>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <limits>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "batch.hpp"
+#include "cli_utils.hpp"
 #include "expectimax.hpp"
 #include "item_manager.hpp"
 #include "levenshtein.hpp"
+#include "policy.hpp"
+#include "reload_values.hpp"
+#include "search_budget.hpp"
+#include "search_stats.hpp"
+#include "server.hpp"
+#include "solution_cache.hpp"
+#include "tablebase.hpp"
+#include "thread_pool.hpp"
+#include "transposition_table.hpp"
 
 bool is_match(std::string_view s1, std::string_view s2) {
 	return compute_levenshtein_distance(s1, s2) <= 3;
@@ -92,27 +107,6 @@ bool prompt_is_live(std::string_view prompt) {
 	}
 }
 
-std::string action_to_str(Action action) {
-	switch (action) {
-		case Action::SHOOT_DEALER:
-			return "shoot dealer";
-		case Action::SHOOT_PLAYER:
-			return "shoot player";
-		case Action::DRINK_BEER:
-			return "drink beer";
-		case Action::SMOKE_CIGARETTE:
-			return "smoke cigarette pack";
-		case Action::USE_MAGNIFYING_GLASS:
-			return "use magnifying glass";
-		case Action::USE_HANDSAW:
-			return "use handsaw";
-		case Action::USE_HANDCUFFS:
-			return "use handcuffs";
-		default:
-			assert(false);
-	}
-}
-
 Action prompt_action(const std::vector<Action> &available_actions) {
 	std::cout << "\n[PROMPT] Select an action for the dealer:\n";
 	for (size_t i = 0; i < available_actions.size(); ++i) {
@@ -137,7 +131,263 @@ Action prompt_action(const std::vector<Action> &available_actions) {
 	}
 }
 
+void print_usage(std::string_view program_name) {
+	std::cout << "Usage: " << program_name << " [options]\n"
+	          << "Options:\n"
+	          << "  --tt-mb <size>  Transposition table size in megabytes (default "
+	          << DEFAULT_TRANSPOSITION_TABLE_SIZE_MB << ").\n"
+	          << "  --tt-size <bytes>\n"
+	          << "                  Transposition table memory budget in bytes, with an\n"
+	          << "                  optional K, M or G suffix (e.g. 512K).\n"
+	          << "  --no-persist-tt Clear the transposition table before every decision.\n"
+	          << "  --stats         Print search statistics after every decision.\n"
+	          << "  --report        Print the EVs of all legal actions, not only the best one.\n"
+	          << "  --batch <path>  Solve one position per line from <path> ('-' for stdin)\n"
+	          << "                  instead of playing interactively.\n"
+	          << "  --batch-chunk <n>\n"
+	          << "                  Lines solved in parallel per chunk in batch mode (default 1\n"
+	          << "                  with one thread, 16 per thread otherwise).\n"
+	          << "  --serve <path>  Answer positions from clients on the Unix domain socket\n"
+	          << "                  <path> instead of playing interactively. Requests and answers\n"
+	          << "                  are lines in the batch format.\n"
+	          << "  --serve-workers <n>\n"
+	          << "                  Clients served at the same time (default "
+	          << DEFAULT_SERVER_CONNECTION_WORKERS << ").\n"
+	          << "  --reloads <n>   Loads after the current one to look into when deciding (0-"
+	          << MAX_RELOADS << ",\n"
+	          << "                  default 0). The session still ends with the current load.\n"
+	          << "  --time-ms <n>   Stop each decision's search after about <n> milliseconds and\n"
+	          << "                  answer from the deepest finished iteration (recursive\n"
+	          << "                  engine only).\n"
+	          << "  --max-nodes <n> Same, but after <n> expanded nodes.\n"
+	          << "  --threads <n>   Number of search threads (default 1).\n"
+	          << "  --engine <name> 'recursive' (default) for the depth-first search over the\n"
+	          << "                  transposition table, or 'retrograde' to enumerate all\n"
+	          << "                  reachable states and solve them bottom-up.\n"
+	          << "  --tablebase <path>\n"
+	          << "                  Endgame tablebase written by tablebase-generator.\n"
+	          << "  --reload-values <path>\n"
+	          << "                  Values of fresh loads written by reload-value-generator,\n"
+	          << "                  scoring the end of the last load searched instead of the\n"
+	          << "                  life difference.\n"
+	          << "  --cache <path>  Keep the best actions of solved positions in <path>, shared\n"
+	          << "                  with other processes using the same file, and answer\n"
+	          << "                  repeated positions from it without searching.\n"
+	          << "  --cache-size <bytes>\n"
+	          << "                  Size of a newly created cache file, with an optional K, M or\n"
+	          << "                  G suffix (default 64M). Existing files keep their size.\n"
+	          << "  --policy <path> Solve the whole load at its first decision, write its policy\n"
+	          << "                  to <path> and answer the rest of the load from it without\n"
+	          << "                  searching. A policy already in <path> is reused if it\n"
+	          << "                  covers the position.\n"
+	          << "  --help          Show this message.\n";
+}
+
 int main(int argc, char **argv) {
+	bool print_stats = false;
+	bool print_report = false;
+	std::optional<std::string> batch_path;
+	std::optional<int> batch_chunk_size;
+	std::optional<std::string> cache_path;
+	std::optional<std::string> policy_path;
+	std::optional<std::string> socket_path;
+	int reloads = 0;
+	int connection_worker_count = DEFAULT_SERVER_CONNECTION_WORKERS;
+	std::size_t cache_size_bytes = DEFAULT_SOLUTION_CACHE_SIZE_BYTES;
+
+	for (int i = 1; i < argc; i++) {
+		std::string_view arg = argv[i];
+
+		if (arg == "--help") {
+			print_usage(argv[0]);
+			return 0;
+		}
+		if (arg == "--tt-mb" && i + 1 < argc) {
+			std::optional<int> size_mb = parse_int(argv[++i]);
+			if (!size_mb || size_mb.value() < 1) {
+				std::cout << "[ERROR] Invalid transposition table size '" << argv[i] << "'.\n";
+				return 1;
+			}
+			if (!tt_manager.resize(size_mb.value())) {
+				std::cout << "[ERROR] Not enough memory for a transposition table of " << argv[i]
+				          << " MB.\n";
+				return 1;
+			}
+			continue;
+		}
+		if (arg == "--tt-size" && i + 1 < argc) {
+			std::optional<std::size_t> size_bytes = parse_byte_size(argv[++i]);
+			if (!size_bytes || size_bytes.value() == 0) {
+				std::cout << "[ERROR] Invalid transposition table size '" << argv[i] << "'.\n";
+				return 1;
+			}
+			const std::optional<std::size_t> memory_bytes = get_physical_memory_bytes();
+			if (memory_bytes && size_bytes.value() > memory_bytes.value()) {
+				std::cout << "[ERROR] Transposition table size '" << argv[i]
+				          << "' is more than the " << memory_bytes.value()
+				          << " bytes of physical memory.\n";
+				print_usage(argv[0]);
+				return 1;
+			}
+			if (!tt_manager.resize_bytes(size_bytes.value())) {
+				std::cout << "[ERROR] Not enough memory for a transposition table of '" << argv[i]
+				          << "'.\n";
+				return 1;
+			}
+			continue;
+		}
+		if (arg == "--threads" && i + 1 < argc) {
+			std::optional<int> thread_count = parse_int(argv[++i]);
+			if (!thread_count || thread_count.value() < 1 || thread_count.value() > 256) {
+				std::cout << "[ERROR] Invalid thread count '" << argv[i] << "'.\n";
+				return 1;
+			}
+			thread_pool.resize(thread_count.value());
+			continue;
+		}
+		if (arg == "--time-ms" && i + 1 < argc) {
+			std::optional<int> time_ms = parse_int(argv[++i]);
+			if (!time_ms || time_ms.value() < 1) {
+				std::cout << "[ERROR] Invalid time budget '" << argv[i] << "'.\n";
+				return 1;
+			}
+			search_limits.time_ms = time_ms.value();
+			continue;
+		}
+		if (arg == "--max-nodes" && i + 1 < argc) {
+			std::optional<int> max_nodes = parse_int(argv[++i]);
+			if (!max_nodes || max_nodes.value() < 1) {
+				std::cout << "[ERROR] Invalid node budget '" << argv[i] << "'.\n";
+				return 1;
+			}
+			search_limits.max_nodes = max_nodes.value();
+			continue;
+		}
+		if (arg == "--engine" && i + 1 < argc) {
+			std::optional<SearchEngine> engine = parse_search_engine(argv[++i]);
+			if (!engine) {
+				std::cout << "[ERROR] Unknown engine '" << argv[i] << "'.\n";
+				return 1;
+			}
+			search_engine = engine.value();
+			continue;
+		}
+		if (arg == "--tablebase" && i + 1 < argc) {
+			if (!tablebase.load(argv[++i])) {
+				std::cout << "[ERROR] Failed to load tablebase '" << argv[i] << "'.\n";
+				return 1;
+			}
+			continue;
+		}
+		if (arg == "--reload-values" && i + 1 < argc) {
+			if (!reload_values.load(argv[++i])) {
+				std::cout << "[ERROR] Failed to load reload values '" << argv[i] << "'.\n";
+				return 1;
+			}
+			continue;
+		}
+		if (arg == "--cache" && i + 1 < argc) {
+			cache_path = argv[++i];
+			continue;
+		}
+		if (arg == "--policy" && i + 1 < argc) {
+			policy_path = argv[++i];
+			continue;
+		}
+		if (arg == "--cache-size" && i + 1 < argc) {
+			std::optional<std::size_t> size_bytes = parse_byte_size(argv[++i]);
+			if (!size_bytes || size_bytes.value() == 0) {
+				std::cout << "[ERROR] Invalid cache size '" << argv[i] << "'.\n";
+				return 1;
+			}
+			cache_size_bytes = size_bytes.value();
+			continue;
+		}
+		if (arg == "--reloads" && i + 1 < argc) {
+			std::optional<int> reload_count = parse_int(argv[++i]);
+			if (!reload_count || reload_count.value() < 0 || reload_count.value() > MAX_RELOADS) {
+				std::cout << "[ERROR] Invalid reload count '" << argv[i] << "'.\n";
+				return 1;
+			}
+			reloads = reload_count.value();
+			continue;
+		}
+		if (arg == "--serve" && i + 1 < argc) {
+			socket_path = argv[++i];
+			continue;
+		}
+		if (arg == "--serve-workers" && i + 1 < argc) {
+			std::optional<int> worker_count = parse_int(argv[++i]);
+			if (!worker_count || worker_count.value() < 1 || worker_count.value() > 1024) {
+				std::cout << "[ERROR] Invalid worker count '" << argv[i] << "'.\n";
+				return 1;
+			}
+			connection_worker_count = worker_count.value();
+			continue;
+		}
+		if (arg == "--batch" && i + 1 < argc) {
+			batch_path = argv[++i];
+			continue;
+		}
+		if (arg == "--batch-chunk" && i + 1 < argc) {
+			batch_chunk_size = parse_int(argv[++i]);
+			if (!batch_chunk_size || batch_chunk_size.value() < 1) {
+				std::cout << "[ERROR] Invalid chunk size '" << argv[i] << "'.\n";
+				return 1;
+			}
+			continue;
+		}
+		if (arg == "--report") {
+			print_report = true;
+			continue;
+		}
+		if (arg == "--stats") {
+			print_stats = true;
+			continue;
+		}
+		if (arg == "--no-persist-tt") {
+			tt_manager.set_persistent(false);
+			continue;
+		}
+
+		std::cout << "[ERROR] Unknown option '" << arg << "'.\n";
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (tablebase.is_loaded() &&
+	    tablebase.get_eval_fingerprint() != reload_values.get_fingerprint()) {
+		std::cout << "[ERROR] The tablebase was generated with different reload values.\n";
+		return 1;
+	}
+	if (cache_path && !solution_cache.open(cache_path.value(), cache_size_bytes)) {
+		std::cout << "[ERROR] Failed to open solution cache '" << cache_path.value() << "'.\n";
+		return 1;
+	}
+
+	if (socket_path) {
+		run_server(socket_path.value(), connection_worker_count, print_report);
+		return 1;
+	}
+
+	if (batch_path) {
+		const int thread_count = thread_pool.get_thread_count();
+		const int chunk_size = batch_chunk_size.value_or(thread_count == 1 ? 1 : thread_count * 16);
+
+		if (batch_path.value() == "-") {
+			solve_batch(std::cin, std::cout, chunk_size, print_report);
+			return 0;
+		}
+
+		std::ifstream file(batch_path.value());
+		if (!file) {
+			std::cout << "[ERROR] Failed to open '" << batch_path.value() << "'.\n";
+			return 1;
+		}
+		solve_batch(file, std::cout, chunk_size, print_report);
+		return 0;
+	}
+
 	int round_num = prompt_num(1, 3, "[PROMPT] Enter current round number (1-3): ");
 
 	uint8_t player_lives;
@@ -179,18 +429,64 @@ int main(int argc, char **argv) {
 
 	Node node(false, false, false, live_round_count, blank_round_count, max_lives, dealer_lives,
 	          player_lives, dealer_items, player_items);
+	node.set_reloads_left(reloads);
+	if (reload_values.is_loaded() && !reload_values.covers(node)) {
+		std::cout << "[INFO] The reload values only cover up to " << reload_values.get_max_lives()
+		          << " max lives and " << reload_values.get_max_items()
+		          << " items per side, so the end of this load is scored by the life difference.\n";
+	}
 
-	while (!node.is_terminal()) {
+	while (!node.is_terminal() && !node.is_reload_pending()) {
 		std::cout << "[INFO] " << node.get_live_round_count() << " live rounds and "
 		          << node.get_blank_round_count() << " blank rounds. Dealer has "
 		          << node.get_dealer_lives() << " lives and player has " << node.get_player_lives()
 		          << " lives.\n";
 		if (node.is_player_turn()) {
 			std::cout << "[INFO] It's the player's turn.\n";
-			auto [best_action, ev] = node.get_best_action();
+			reset_search_stats();
+			if (policy_path && !policy.probe(node) &&
+			    !(policy.load(policy_path.value()) && policy.probe(node))) {
+				policy.build(node);
+				std::cout << "[INFO] Solved the policy of this load: " << policy.get_size()
+				          << " decisions.\n";
+				if (!policy.save(policy_path.value())) {
+					std::cout << "[ERROR] Failed to write policy '" << policy_path.value()
+					          << "'.\n";
+				}
+			}
+			// Without a report only the best action is needed, which the policy and the solution
+			// cache can answer. A limited search also tells how deep it got, but the policy is
+			// exact anyway.
+			ActionValues action_values;
+			if (print_report || (search_limits.is_limited() && !policy_path)) {
+				action_values = node.get_action_values();
+			}
+			else {
+				const auto [action, ev] = node.get_best_action();
+				action_values.push(action, ev);
+			}
+			auto [best_action, ev] = action_values.front();
 
 			std::string action_str = action_to_str(best_action);
 			std::cout << "\n[INFO] Best action: " << action_str << " with eval " << ev << ".\n";
+			if (!action_values.is_exact()) {
+				std::cout << "[INFO] The search budget ran out after " << action_values.get_depth()
+				          << " plies, so the evals are estimates.\n";
+			}
+			if (print_report) {
+				for (int i = 1; i < action_values.size(); i++) {
+					std::cout << "[INFO] Alternative: " << action_to_str(action_values[i].first)
+					          << " with eval " << action_values[i].second << " (regret "
+					          << ev - action_values[i].second << ").\n";
+				}
+			}
+			if (print_stats) {
+				print_search_stats(std::cout, get_search_stats());
+				std::cout << "[STATS] Transposition table usage: " << std::fixed
+				          << std::setprecision(1) << tt_manager.get_usage() * 100.0
+				          << std::defaultfloat << "% of " << tt_manager.get_capacity()
+				          << " entries (" << tt_manager.get_size_bytes() << " bytes).\n";
+			}
 
 			switch (best_action) {
 				case Action::SHOOT_DEALER: {
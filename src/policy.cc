@@ -0,0 +1,139 @@
+#include "policy.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <numeric>
+
+#include "reload_values.hpp"
+#include "retrograde.hpp"
+
+namespace {
+constexpr char POLICY_MAGIC[8] = {'B', 'R', 'S', 'P', 'O', 'L', 'C', 'Y'};
+constexpr uint32_t POLICY_VERSION = 1;
+constexpr uint64_t ENTRY_SIZE = sizeof(uint64_t) + sizeof(float) + sizeof(uint8_t);
+}  // namespace
+
+void Policy::build(const Node &root) {
+	assert(root.is_player_turn());
+
+	std::vector<uint64_t> keys;
+	std::vector<float> evs;
+	std::vector<uint8_t> actions;
+
+	RetrogradeSolver solver;
+	const auto [root_action, root_ev] = solver.get_action_values(root).front();
+	keys.push_back(root.get_canonical().state);
+	evs.push_back(root_ev);
+	actions.push_back(static_cast<uint8_t>(root_action));
+	solver.for_each_decision([&](const Node &node, Action action, float ev) {
+		keys.push_back(node.state);
+		evs.push_back(ev);
+		actions.push_back(static_cast<uint8_t>(action));
+	});
+
+	std::vector<uint32_t> order(keys.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(),
+	          [&](uint32_t lhs, uint32_t rhs) { return keys[lhs] < keys[rhs]; });
+
+	this->clear();
+	this->keys.reserve(order.size());
+	this->evs.reserve(order.size());
+	this->actions.reserve(order.size());
+	for (uint32_t i : order) {
+		this->keys.push_back(keys[i]);
+		this->evs.push_back(evs[i]);
+		this->actions.push_back(actions[i]);
+	}
+}
+
+void Policy::clear(void) {
+	this->keys.clear();
+	this->evs.clear();
+	this->actions.clear();
+}
+
+std::size_t Policy::get_size(void) const { return this->keys.size(); }
+
+std::size_t Policy::get_file_size(void) const {
+	return sizeof(PolicyHeader) + this->keys.size() * ENTRY_SIZE;
+}
+
+Node Policy::get_position(std::size_t index) const {
+	Node node(false, false, false, 0, 0, 0, 0, 0, ItemManager(), ItemManager());
+	node.state = this->keys[index];
+	return node;
+}
+
+std::optional<std::pair<Action, float>> Policy::probe(const Node &node) const {
+	if (this->keys.empty() || node.is_dealer_turn()) {
+		return std::nullopt;
+	}
+	const uint64_t key = node.get_canonical_on_turn<false>().state;
+	const auto match = std::lower_bound(this->keys.begin(), this->keys.end(), key);
+	if (match == this->keys.end() || *match != key) {
+		return std::nullopt;
+	}
+	const std::size_t index = match - this->keys.begin();
+	return std::make_pair(static_cast<Action>(this->actions[index]), this->evs[index]);
+}
+
+bool Policy::save(const std::string &path) const {
+	PolicyHeader header = {};
+	std::memcpy(header.magic, POLICY_MAGIC, sizeof(POLICY_MAGIC));
+	header.version = POLICY_VERSION;
+	header.eval_fingerprint = reload_values.get_fingerprint();
+	header.entry_count = this->keys.size();
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(this->keys.data()),
+	           this->keys.size() * sizeof(uint64_t));
+	file.write(reinterpret_cast<const char *>(this->evs.data()), this->evs.size() * sizeof(float));
+	file.write(reinterpret_cast<const char *>(this->actions.data()), this->actions.size());
+	return static_cast<bool>(file);
+}
+
+bool Policy::load(const std::string &path) {
+	this->clear();
+
+	std::ifstream file(path, std::ios::binary);
+	PolicyHeader header;
+	if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+	    std::memcmp(header.magic, POLICY_MAGIC, sizeof(POLICY_MAGIC)) != 0 ||
+	    header.version != POLICY_VERSION ||
+	    header.eval_fingerprint != reload_values.get_fingerprint()) {
+		return false;
+	}
+
+	// The size is checked against the file before allocating, so a corrupt count can't ask for
+	// more memory than the file holds.
+	const std::streampos data_begin = file.tellg();
+	file.seekg(0, std::ios::end);
+	const uint64_t data_size = static_cast<uint64_t>(file.tellg() - data_begin);
+	if (data_size % ENTRY_SIZE != 0 || header.entry_count != data_size / ENTRY_SIZE) {
+		return false;
+	}
+	file.seekg(data_begin);
+
+	this->keys.resize(header.entry_count);
+	this->evs.resize(header.entry_count);
+	this->actions.resize(header.entry_count);
+	file.read(reinterpret_cast<char *>(this->keys.data()), this->keys.size() * sizeof(uint64_t));
+	file.read(reinterpret_cast<char *>(this->evs.data()), this->evs.size() * sizeof(float));
+	file.read(reinterpret_cast<char *>(this->actions.data()), this->actions.size());
+
+	const bool valid =
+	    file &&
+	    std::adjacent_find(this->keys.begin(), this->keys.end(), std::greater_equal<uint64_t>()) ==
+	        this->keys.end() &&
+	    std::all_of(this->actions.begin(), this->actions.end(),
+	                [](uint8_t action) { return action < ACTION_COUNT; });
+	if (!valid) {
+		this->clear();
+	}
+	return valid;
+}
@@ -0,0 +1,57 @@
+#ifndef POLICY_HPP
+#define POLICY_HPP
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "expectimax.hpp"
+
+// The complete optimal policy of one load: the best action and exact EV of the root and of every
+// player decision reachable from it before the load runs out. One retrograde solve of the root
+// values all of them at once, so a game that follows the policy never searches again until the
+// next load. Decisions are keyed by their canonical packed state and kept sorted, so a lookup is
+// one binary search.
+//
+// File layout:
+//   PolicyHeader
+//   uint64_t keys[entry_count]
+//   float evs[entry_count]
+//   uint8_t actions[entry_count]
+class Policy final {
+   public:
+	// Solves `root` with the retrograde engine and replaces the policy with the one of its load.
+	// The root must be a player decision.
+	void build(const Node &root);
+	void clear(void);
+	std::size_t get_size(void) const;
+	// Size of the policy's file in bytes.
+	std::size_t get_file_size(void) const;
+	// The decision at `index` in key order, in canonical form.
+	Node get_position(std::size_t index) const;
+	std::optional<std::pair<Action, float>> probe(const Node &node) const;
+
+	bool save(const std::string &path) const;
+	// Reads the file at `path`. Returns false (and leaves the policy empty) if the file can't be
+	// read, was written by an incompatible version or holds EVs solved with other reload values
+	// than the loaded ones (see reload_values.hpp).
+	bool load(const std::string &path);
+
+   private:
+	struct PolicyHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t eval_fingerprint;
+		uint64_t entry_count;
+	};
+
+	std::vector<uint64_t> keys;
+	std::vector<float> evs;
+	std::vector<uint8_t> actions;
+};
+
+extern Policy policy;
+
+#endif  // POLICY_HPP
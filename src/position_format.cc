@@ -0,0 +1,113 @@
+#include "position_format.hpp"
+
+#include <cctype>
+#include <vector>
+
+#include "cli_utils.hpp"
+#include "item_manager.hpp"
+
+namespace {
+std::vector<std::string_view> split_fields(std::string_view line) {
+	std::vector<std::string_view> fields;
+	std::size_t pos = 0;
+
+	while (pos < line.size()) {
+		while (pos < line.size() && std::isspace(static_cast<unsigned char>(line[pos]))) {
+			pos++;
+		}
+		const std::size_t start = pos;
+		while (pos < line.size() && !std::isspace(static_cast<unsigned char>(line[pos]))) {
+			pos++;
+		}
+		if (pos > start) {
+			fields.push_back(line.substr(start, pos - start));
+		}
+	}
+	return fields;
+}
+
+std::optional<ItemManager> parse_items(std::string_view field) {
+	if (field.size() != 5) {
+		return std::nullopt;
+	}
+
+	int counts[5];
+	int total = 0;
+	for (int i = 0; i < 5; i++) {
+		if (field[i] < '0' || field[i] > '8') {
+			return std::nullopt;
+		}
+		counts[i] = field[i] - '0';
+		total += counts[i];
+	}
+	if (total > 8) {
+		return std::nullopt;
+	}
+	return ItemManager(counts[0], counts[1], counts[2], counts[3], counts[4]);
+}
+}  // namespace
+
+std::optional<Node> parse_position(std::string_view line, std::string &error) {
+	const std::vector<std::string_view> fields = split_fields(line);
+	if (fields.size() != 8 && fields.size() != 9) {
+		error = "expected 8 or 9 fields";
+		return std::nullopt;
+	}
+
+	int numbers[5];
+	for (int i = 0; i < 5; i++) {
+		std::optional<int> number = parse_int(fields[i]);
+		if (!number) {
+			error = "invalid number '" + std::string(fields[i]) + "'";
+			return std::nullopt;
+		}
+		numbers[i] = number.value();
+	}
+	const auto [max_lives, dealer_lives, player_lives, live, blank] = numbers;
+
+	if (max_lives != 2 && max_lives != 4 && max_lives != 6) {
+		error = "max lives must be 2, 4 or 6";
+		return std::nullopt;
+	}
+	if (dealer_lives < 1 || dealer_lives > max_lives || player_lives < 1 ||
+	    player_lives > max_lives) {
+		error = "lives must be between 1 and max lives";
+		return std::nullopt;
+	}
+	if (live < 0 || blank < 0 || live + blank < 1 || live + blank > 8) {
+		error = "there must be between 1 and 8 shells";
+		return std::nullopt;
+	}
+
+	const std::string_view known = fields[5];
+	if (known != "-" && known != "L" && known != "B") {
+		error = "known round must be '-', 'L' or 'B'";
+		return std::nullopt;
+	}
+	if ((known == "L" && live == 0) || (known == "B" && blank == 0)) {
+		error = "known round is not in the shotgun";
+		return std::nullopt;
+	}
+
+	const std::optional<ItemManager> dealer_items = parse_items(fields[6]);
+	const std::optional<ItemManager> player_items = parse_items(fields[7]);
+	if (!dealer_items || !player_items) {
+		error = "item sets must be five digits with at most 8 items in total";
+		return std::nullopt;
+	}
+
+	int reloads = 0;
+	if (fields.size() == 9) {
+		std::optional<int> number = parse_int(fields[8]);
+		if (!number || number.value() < 0 || number.value() > MAX_RELOADS) {
+			error = "reloads must be between 0 and " + std::to_string(MAX_RELOADS);
+			return std::nullopt;
+		}
+		reloads = number.value();
+	}
+
+	Node node(false, known == "L", known == "B", live, blank, max_lives, dealer_lives,
+	          player_lives, dealer_items.value(), player_items.value());
+	node.set_reloads_left(reloads);
+	return node;
+}
@@ -0,0 +1,26 @@
+#ifndef POSITION_FORMAT_HPP
+#define POSITION_FORMAT_HPP
+
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "expectimax.hpp"
+
+// Compact one-line position format used by the batch mode:
+//
+//   <max lives> <dealer lives> <player lives> <live> <blank> <known> <dealer items> <player items>
+//   [<reloads>]
+//
+// <known> is '-' if the chambered round is unknown, 'L' if it is known to be live and 'B' if it
+// is known to be blank. Item sets are five digits giving the number of magnifying glasses,
+// cigarette packs, beers, handsaws and handcuffs, in that order. The optional <reloads> (0 to
+// MAX_RELOADS, default 0) is the number of later loads the search looks into (see reload.hpp).
+// The player is to move.
+//
+// Example: "6 5 4 3 2 - 21010 11201"
+
+// Returns nullopt and sets `error` if `line` isn't a valid position.
+std::optional<Node> parse_position(std::string_view line, std::string &error);
+
+#endif  // POSITION_FORMAT_HPP
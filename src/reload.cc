@@ -0,0 +1,199 @@
+#include "reload.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <vector>
+
+#include "search_budget.hpp"
+#include "search_stats.hpp"
+
+namespace {
+constexpr int MIN_LOAD_SHELLS = 2;
+constexpr int MAX_LOAD_SHELLS = 8;
+constexpr int MAX_HELD_ITEMS = 8;
+// A load draws at most 4 items, and there are C(4 + 4, 4) ways to draw 4 items of 5 kinds.
+constexpr int MAX_DRAWN_ITEMS = 4;
+constexpr int MAX_ITEM_REFILLS = 70;
+static_assert(ITEM_KIND_COUNT == 5, "MAX_ITEM_REFILLS counts draws of 5 item kinds");
+
+struct ItemRefill {
+	ItemManager items;
+	float probability;
+};
+
+// Fixed capacity, so that expanding a reload doesn't allocate.
+struct ItemRefills {
+	std::array<ItemRefill, MAX_ITEM_REFILLS> refills;
+	int size = 0;
+
+	void push_back(const ItemRefill &refill) {
+		assert(this->size < MAX_ITEM_REFILLS);
+		this->refills[this->size++] = refill;
+	}
+	const ItemRefill *begin(void) const { return this->refills.data(); }
+	const ItemRefill *end(void) const { return this->refills.data() + this->size; }
+};
+
+// Slot of `key` in a shard of `slot_count` slots, a power of two. The shard is picked by the top
+// 6 bits of the same hash, so the slot takes the bits right below them.
+std::size_t get_slot(uint64_t key, std::size_t slot_count) {
+	return ((key * 0x9E3779B97F4A7C15ull) << 6) >> (64 - __builtin_ctzll(slot_count));
+}
+
+// Adds the refills that draw `remaining` more items of kind `kind` or later. `weight` is the
+// product of 1 / count! over the kinds drawn so far, so the multinomial probability of a refill
+// is draws! * weight / ITEM_KIND_COUNT^draws.
+void add_item_refills(ItemRefills &refills, uint32_t items, int kind, int remaining,
+                      double weight, double scale) {
+	const uint32_t unit = ItemManager::get_unit(static_cast<Item>(kind));
+	if (kind == ITEM_KIND_COUNT - 1) {
+		for (int count = 2; count <= remaining; count++) {
+			weight /= count;
+		}
+		refills.push_back({ItemManager::from_bits(items + remaining * unit),
+		                   static_cast<float>(weight * scale)});
+		return;
+	}
+
+	double count_weight = weight;
+	for (int count = 0; count <= remaining; count++) {
+		if (count > 0) {
+			count_weight /= count;
+		}
+		add_item_refills(refills, items + count * unit, kind + 1, remaining - count, count_weight,
+		                 scale);
+	}
+}
+
+// Every item set `items` can turn into by drawing `draw_count` items, with its probability.
+ItemRefills get_item_refills(ItemManager items, int draw_count) {
+	const int draws = std::max(0, std::min(draw_count, MAX_HELD_ITEMS - items.get_item_count()));
+	assert(draws <= MAX_DRAWN_ITEMS);
+	double scale = 1.0;
+	for (int i = 1; i <= draws; i++) {
+		scale *= static_cast<double>(i) / ITEM_KIND_COUNT;
+	}
+
+	ItemRefills refills;
+	add_item_refills(refills, items.to_bits(), 0, draws, 1.0, scale);
+	return refills;
+}
+}  // namespace
+
+Node ReloadTable::get_key(const Node &node) {
+	Node key = node;
+	key.set_dealer_turn(false);
+	key.set_round_known_live(false);
+	key.set_round_known_blank(false);
+	key.set_handsaw_applied(false);
+	key.set_handcuffs_applied(false);
+	key.set_handcuffs_available(true);
+	return key;
+}
+
+float ReloadTable::compute_value(const Node &key) const {
+	// Each load adds two items per max lives above 2: none in round 1, 2 in round 2, 4 in round 3.
+	const int draw_count = key.get_max_lives() - 2;
+	const ItemRefills dealer_refills = get_item_refills(key.get_dealer_items(), draw_count);
+	const ItemRefills player_refills = get_item_refills(key.get_player_items(), draw_count);
+	const float load_probability = 1.0f / (MAX_LOAD_SHELLS - MIN_LOAD_SHELLS + 1);
+
+	float ev = 0.0f;
+	for (int shells = MIN_LOAD_SHELLS; shells <= MAX_LOAD_SHELLS; shells++) {
+		Node loaded = key;
+		loaded.set_live_round_count(shells / 2);
+		loaded.set_blank_round_count(shells - shells / 2);
+		loaded.set_reloads_left(key.get_reloads_left() - 1);
+
+		float load_ev = 0.0f;
+		for (const ItemRefill &dealer_refill : dealer_refills) {
+			loaded.set_dealer_items(dealer_refill.items);
+			for (const ItemRefill &player_refill : player_refills) {
+				loaded.set_player_items(player_refill.items);
+				load_ev += loaded.expectimax() * dealer_refill.probability *
+				           player_refill.probability;
+			}
+		}
+		ev += load_ev * load_probability;
+	}
+	return ev;
+}
+
+float ReloadTable::get_value(const Node &node) {
+	assert(node.is_reload_pending());
+	SEARCH_STATS_INCREMENT(reload_nodes);
+
+	const Node key = get_key(node);
+	Shard &shard = this->shards[(key.state * 0x9E3779B97F4A7C15ull) >> 58];
+	static_assert(SHARD_COUNT == 64, "the shard index takes the top 6 bits of the hash");
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		if (const float *value = shard.find(key.state)) {
+			return *value;
+		}
+	}
+
+	// Computed without holding the lock, as the loads below reach further reloads.
+	SEARCH_STATS_INCREMENT(reload_expansions);
+	const float ev = this->compute_value(key);
+	if (thread_search_budget != nullptr && thread_search_budget->is_spent()) {
+		return ev;
+	}
+	{
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		shard.insert(key.state, ev);
+	}
+	return ev;
+}
+
+void ReloadTable::clear(void) {
+	for (Shard &shard : this->shards) {
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		std::fill(shard.keys.begin(), shard.keys.end(), 0);
+		shard.size = 0;
+	}
+}
+
+float *ReloadTable::Shard::find(uint64_t key) {
+	std::size_t slot = get_slot(key, this->keys.size());
+	while (this->keys[slot] != 0) {
+		if (this->keys[slot] == key) {
+			return &this->values[slot];
+		}
+		slot = (slot + 1) & (this->keys.size() - 1);
+	}
+	return nullptr;
+}
+
+void ReloadTable::Shard::insert(uint64_t key, float value) {
+	// Another thread may have stored the same value in the meantime.
+	if (float *stored = this->find(key)) {
+		*stored = value;
+		return;
+	}
+
+	if (2 * (this->size + 1) > this->keys.size()) {
+		std::vector<uint64_t> old_keys(this->keys.size() * 2);
+		std::vector<float> old_values(old_keys.size());
+		old_keys.swap(this->keys);
+		old_values.swap(this->values);
+		for (std::size_t i = 0; i < old_keys.size(); i++) {
+			if (old_keys[i] != 0) {
+				std::size_t slot = get_slot(old_keys[i], this->keys.size());
+				while (this->keys[slot] != 0) {
+					slot = (slot + 1) & (this->keys.size() - 1);
+				}
+				this->keys[slot] = old_keys[i];
+				this->values[slot] = old_values[i];
+			}
+		}
+	}
+
+	std::size_t slot = get_slot(key, this->keys.size());
+	while (this->keys[slot] != 0) {
+		slot = (slot + 1) & (this->keys.size() - 1);
+	}
+	this->keys[slot] = key;
+	this->values[slot] = value;
+	this->size++;
+}
@@ -0,0 +1,58 @@
+#ifndef RELOAD_HPP
+#define RELOAD_HPP
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "expectimax.hpp"
+
+// Model of the shotgun being reloaded once a load runs out with both sides alive:
+//   - The new load has 2 to 8 shells, each count equally likely, of which half rounded down
+//     are live.
+//   - Each side then draws items of uniformly random kinds: none with 2 max lives, 2 with 4 and
+//     4 with 6, but never beyond 8 items held.
+//   - The player moves first, with nothing known about the chambered round and no handsaw or
+//     handcuffs applied.
+// Lives, max lives and left-over items carry over, so the value of a reload depends on nothing
+// else. ReloadTable memoizes it per (lives, max lives, items, reloads left), and every new load
+// below it is searched like any other position, sharing the transposition table.
+class ReloadTable final {
+   public:
+	ReloadTable() = default;
+
+	ReloadTable(const ReloadTable &) = delete;
+	ReloadTable &operator=(const ReloadTable &) = delete;
+
+	// EV of a node with `is_reload_pending()`. Safe to call from several threads; a value that
+	// two threads miss at once is computed by both.
+	float get_value(const Node &node);
+	void clear(void);
+
+   private:
+	static constexpr int SHARD_COUNT = 64;
+
+	// The fields a reload value depends on, with everything else cleared.
+	static Node get_key(const Node &node);
+	float compute_value(const Node &key) const;
+
+	// Open-addressing table of the values of one shard. Keys always hold lives, so they are
+	// never zero, which marks an empty slot. Slots are allocated up front and kept by `clear`,
+	// so a warm table only allocates to grow.
+	struct Shard {
+		std::mutex mutex;
+		std::vector<uint64_t> keys = std::vector<uint64_t>(INITIAL_SHARD_SLOT_COUNT);
+		std::vector<float> values = std::vector<float>(INITIAL_SHARD_SLOT_COUNT);
+		std::size_t size = 0;
+
+		float *find(uint64_t key);
+		void insert(uint64_t key, float value);
+	};
+	static constexpr std::size_t INITIAL_SHARD_SLOT_COUNT = 64;
+	std::array<Shard, SHARD_COUNT> shards;
+};
+
+extern ReloadTable reload_table;
+
+#endif  // RELOAD_HPP
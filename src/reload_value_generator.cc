@@ -0,0 +1,95 @@
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "cli_utils.hpp"
+#include "reload_values.hpp"
+#include "thread_pool.hpp"
+#include "transposition_table.hpp"
+
+void print_usage(std::string_view program_name) {
+	std::cout << "Usage: " << program_name << " [options]\n"
+	          << "Options:\n"
+	          << "  --output <path>     Output file (default reload_values.bin).\n"
+	          << "  --max-lives <n>     Largest max lives covered: 2 for round 1, 4 for rounds 1\n"
+	          << "                      and 2, 6 for all rounds (default "
+	          << DEFAULT_RELOAD_VALUES_MAX_LIVES << ").\n"
+	          << "  --max-items <n>     Largest item count per side covered (default "
+	          << DEFAULT_RELOAD_VALUES_MAX_ITEMS << ").\n"
+	          << "  --threads <n>       Number of solver threads (default 1).\n"
+	          << "  --tt-mb <size>      Transposition table size in megabytes (default "
+	          << DEFAULT_TRANSPOSITION_TABLE_SIZE_MB << ").\n"
+	          << "  --help              Show this message.\n";
+}
+
+int main(int argc, char **argv) {
+	std::string output_path = "reload_values.bin";
+	int max_lives = DEFAULT_RELOAD_VALUES_MAX_LIVES;
+	int max_items = DEFAULT_RELOAD_VALUES_MAX_ITEMS;
+
+	for (int i = 1; i < argc; i++) {
+		std::string_view arg = argv[i];
+		std::optional<int> value;
+
+		if (arg == "--help") {
+			print_usage(argv[0]);
+			return 0;
+		}
+		if (arg == "--output" && i + 1 < argc) {
+			output_path = argv[++i];
+			continue;
+		}
+		if (arg == "--max-lives" && i + 1 < argc) {
+			value = parse_int(argv[++i]);
+			if (!value || (value.value() != 2 && value.value() != 4 && value.value() != 6)) {
+				std::cout << "[ERROR] Invalid max lives '" << argv[i] << "' (2, 4 or 6).\n";
+				return 1;
+			}
+			max_lives = value.value();
+			continue;
+		}
+		if (arg == "--max-items" && i + 1 < argc) {
+			value = parse_int(argv[++i]);
+			if (!value || value.value() < 0 || value.value() > 8) {
+				std::cout << "[ERROR] Invalid item count '" << argv[i] << "' (0-8).\n";
+				return 1;
+			}
+			max_items = value.value();
+			continue;
+		}
+		if (arg == "--threads" && i + 1 < argc) {
+			value = parse_int(argv[++i]);
+			if (!value || value.value() < 1 || value.value() > 256) {
+				std::cout << "[ERROR] Invalid thread count '" << argv[i] << "'.\n";
+				return 1;
+			}
+			thread_pool.resize(value.value());
+			continue;
+		}
+		if (arg == "--tt-mb" && i + 1 < argc) {
+			value = parse_int(argv[++i]);
+			if (!value || value.value() < 1) {
+				std::cout << "[ERROR] Invalid transposition table size '" << argv[i] << "'.\n";
+				return 1;
+			}
+			if (!tt_manager.resize(value.value())) {
+				std::cout << "[ERROR] Not enough memory for a transposition table of " << argv[i]
+				          << " MB.\n";
+				return 1;
+			}
+			continue;
+		}
+
+		std::cout << "[ERROR] Unknown option '" << arg << "'.\n";
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (!reload_values.generate(output_path, max_lives, max_items)) {
+		std::cout << "[ERROR] Failed to write '" << output_path << "'.\n";
+		return 1;
+	}
+	std::cout << "[INFO] Wrote reload values to '" << output_path << "'.\n";
+	return 0;
+}
@@ -0,0 +1,243 @@
+#include "reload_values.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "reload.hpp"
+#include "thread_pool.hpp"
+#include "transposition_table.hpp"
+
+namespace {
+constexpr char RELOAD_VALUES_MAGIC[8] = {'B', 'R', 'S', 'R', 'E', 'L', 'O', 'D'};
+constexpr uint32_t RELOAD_VALUES_VERSION = 1;
+
+// Value iteration stops once no value moves by more than this between two iterations, or after
+// MAX_ITERATIONS. Every load ends the game with a good chance, so the changes shrink by a
+// constant factor per iteration and the limit is only a guard.
+constexpr float CONVERGENCE_TOLERANCE = 1e-3f;
+constexpr int MAX_ITERATIONS = 200;
+
+// FNV-1a over the coverage and the entries. Never 0, which stands for the plain evaluation.
+uint32_t compute_fingerprint(uint32_t max_lives, uint32_t max_items, const float *entries,
+                             std::size_t entry_count) {
+	uint32_t hash = 2166136261u;
+	const auto add_bytes = [&](const void *data, std::size_t size) {
+		for (std::size_t i = 0; i < size; i++) {
+			hash = (hash ^ static_cast<const unsigned char *>(data)[i]) * 16777619u;
+		}
+	};
+	add_bytes(&max_lives, sizeof(max_lives));
+	add_bytes(&max_items, sizeof(max_items));
+	add_bytes(entries, entry_count * sizeof(float));
+	return hash != 0 ? hash : 1;
+}
+}  // namespace
+
+ReloadValues::~ReloadValues() { this->unload(); }
+
+void ReloadValues::set_coverage(int max_lives, int max_items) {
+	this->max_lives = max_lives;
+	this->item_set_index.set_max_items(max_items);
+}
+
+std::size_t ReloadValues::get_entry_count(void) const {
+	// Lives indices are ordered by max lives, so the covered tiers are a prefix of them.
+	const std::size_t lives_state_count =
+	    this->max_lives > 0
+	        ? get_lives_index(this->max_lives, this->max_lives, this->max_lives) + 1
+	        : 0;
+	return lives_state_count * this->item_set_index.get_count() *
+	       this->item_set_index.get_count();
+}
+
+std::optional<std::size_t> ReloadValues::get_index(const Node &node) const {
+	if (node.get_max_lives() > this->max_lives) {
+		return std::nullopt;
+	}
+	const int lives_index =
+	    get_lives_index(node.get_max_lives(), node.get_dealer_lives(), node.get_player_lives());
+	const int dealer_item_index = this->item_set_index.get_index(node.get_dealer_items());
+	const int player_item_index = this->item_set_index.get_index(node.get_player_items());
+	if (lives_index < 0 || dealer_item_index < 0 || player_item_index < 0) {
+		return std::nullopt;
+	}
+
+	std::size_t index = lives_index;
+	index = index * this->item_set_index.get_count() + dealer_item_index;
+	index = index * this->item_set_index.get_count() + player_item_index;
+	return index;
+}
+
+std::optional<float> ReloadValues::probe(const Node &node) const {
+	if (this->entries == nullptr) {
+		return std::nullopt;
+	}
+
+	const std::optional<std::size_t> index = this->get_index(node);
+	if (!index) {
+		return std::nullopt;
+	}
+	return this->entries[index.value()];
+}
+
+bool ReloadValues::is_loaded(void) const { return this->entries != nullptr; }
+
+bool ReloadValues::covers(const Node &node) const {
+	return this->is_loaded() && this->get_index(node).has_value();
+}
+
+int ReloadValues::get_max_lives(void) const { return this->max_lives; }
+
+int ReloadValues::get_max_items(void) const { return this->item_set_index.get_max_items(); }
+
+uint32_t ReloadValues::get_fingerprint(void) const { return this->fingerprint; }
+
+bool ReloadValues::load(const std::string &path) {
+	this->unload();
+
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 ||
+	    static_cast<std::size_t>(file_stat.st_size) < sizeof(ReloadValuesHeader)) {
+		close(fd);
+		return false;
+	}
+
+	const std::size_t size = file_stat.st_size;
+	void *mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		return false;
+	}
+
+	ReloadValuesHeader header;
+	std::memcpy(&header, mapping, sizeof(header));
+
+	if (std::memcmp(header.magic, RELOAD_VALUES_MAGIC, sizeof(RELOAD_VALUES_MAGIC)) != 0 ||
+	    header.version != RELOAD_VALUES_VERSION || get_lives_index(header.max_lives, 1, 1) < 0 ||
+	    header.max_items > 8) {
+		munmap(mapping, size);
+		return false;
+	}
+
+	this->set_coverage(header.max_lives, header.max_items);
+	if (header.entry_count != this->get_entry_count() ||
+	    size != sizeof(ReloadValuesHeader) + header.entry_count * sizeof(float)) {
+		munmap(mapping, size);
+		this->set_coverage(0, 0);
+		return false;
+	}
+
+	this->mapping = mapping;
+	this->mapping_size = size;
+	this->entries = reinterpret_cast<const float *>(static_cast<const char *>(mapping) +
+	                                                sizeof(ReloadValuesHeader));
+	this->fingerprint =
+	    compute_fingerprint(header.max_lives, header.max_items, this->entries, header.entry_count);
+	return true;
+}
+
+void ReloadValues::unload(void) {
+	if (this->mapping != nullptr) {
+		munmap(this->mapping, this->mapping_size);
+	}
+	this->mapping = nullptr;
+	this->mapping_size = 0;
+	this->entries = nullptr;
+	this->fingerprint = 0;
+	this->generated_entries.clear();
+	this->generated_entries.shrink_to_fit();
+	this->set_coverage(0, 0);
+}
+
+bool ReloadValues::generate(const std::string &path, int max_lives, int max_items) {
+	this->unload();
+	this->set_coverage(max_lives, max_items);
+
+	// A pending reload for every covered state, in entry order, starting out at the life
+	// difference the plain evaluation scores it with.
+	std::vector<Node> reloads;
+	reloads.reserve(this->get_entry_count());
+	this->generated_entries.reserve(this->get_entry_count());
+	for (int tier_lives = 2; tier_lives <= max_lives; tier_lives += 2) {
+		for (int dealer_lives = 1; dealer_lives <= tier_lives; dealer_lives++) {
+			for (int player_lives = 1; player_lives <= tier_lives; player_lives++) {
+				for (int dealer_index = 0; dealer_index < this->item_set_index.get_count();
+				     dealer_index++) {
+					for (int player_index = 0; player_index < this->item_set_index.get_count();
+					     player_index++) {
+						Node node(false, false, false, 0, 0, tier_lives, dealer_lives,
+						          player_lives, this->item_set_index.get_items(dealer_index),
+						          this->item_set_index.get_items(player_index));
+						node.set_reloads_left(1);
+						assert(this->get_index(node).value() == reloads.size());
+						reloads.push_back(node);
+						this->generated_entries.push_back(
+						    static_cast<float>((player_lives - dealer_lives) * 10));
+					}
+				}
+			}
+		}
+	}
+	this->entries = this->generated_entries.data();
+
+	// Jacobi iteration: all states are solved against the previous values, which the searches
+	// probe through `entries`, so the result doesn't depend on the order states are solved in.
+	// The transposition table and the reload memo hold EVs of the previous values and are
+	// cleared every time.
+	std::vector<float> next_entries(this->generated_entries.size());
+	for (int iteration = 1;; iteration++) {
+		tt_manager.clear_table();
+		reload_table.clear();
+		thread_pool.parallel_for(static_cast<int>(reloads.size()), [&](int i) {
+			next_entries[i] = reload_table.get_value(reloads[i]);
+		});
+
+		float largest_change = 0.0f;
+		for (std::size_t i = 0; i < next_entries.size(); i++) {
+			largest_change =
+			    std::max(largest_change, std::fabs(next_entries[i] - this->generated_entries[i]));
+		}
+		this->generated_entries.swap(next_entries);
+		this->entries = this->generated_entries.data();
+
+		std::cout << "[INFO] Iteration " << iteration << ": largest change " << largest_change
+		          << '.' << std::endl;
+		if (largest_change <= CONVERGENCE_TOLERANCE) {
+			break;
+		}
+		if (iteration == MAX_ITERATIONS) {
+			std::cout << "[INFO] Stopped after " << MAX_ITERATIONS
+			          << " iterations without converging.\n";
+			break;
+		}
+	}
+	tt_manager.clear_table();
+	reload_table.clear();
+
+	ReloadValuesHeader header = {};
+	std::memcpy(header.magic, RELOAD_VALUES_MAGIC, sizeof(RELOAD_VALUES_MAGIC));
+	header.version = RELOAD_VALUES_VERSION;
+	header.max_lives = max_lives;
+	header.max_items = max_items;
+	header.entry_count = this->generated_entries.size();
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(this->generated_entries.data()),
+	           this->generated_entries.size() * sizeof(float));
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,85 @@
+#ifndef RELOAD_VALUES_HPP
+#define RELOAD_VALUES_HPP
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "expectimax.hpp"
+#include "state_index.hpp"
+
+constexpr int DEFAULT_RELOAD_VALUES_MAX_LIVES = 2;
+constexpr int DEFAULT_RELOAD_VALUES_MAX_ITEMS = 0;
+
+// EVs of the game from a fresh load on, with the reload model of reload.hpp repeated until one
+// side is dead, per max lives, lives and item set of each side. Loaded, they replace the life
+// difference that `Node::eval` scores a load running out with, so searches that end with their
+// load still value the lives and items carried into the next one. States outside the covered
+// max lives and item counts keep the life difference.
+//
+// Like the tablebase, the file is a fixed header followed by one float per state and is
+// memory-mapped.
+//
+// File layout:
+//   ReloadValuesHeader
+//   float entries[entry_count]
+class ReloadValues final {
+   public:
+	ReloadValues() = default;
+	~ReloadValues();
+
+	ReloadValues(const ReloadValues &) = delete;
+	ReloadValues &operator=(const ReloadValues &) = delete;
+
+	// Maps the file at `path`. Returns false (and leaves the table empty) if the file can't be
+	// mapped or was not written by a compatible generator.
+	bool load(const std::string &path);
+	void unload(void);
+	bool is_loaded(void) const;
+	// The value of a fresh load with the lives and items of `node`; its shells and flags are
+	// ignored.
+	std::optional<float> probe(const Node &node) const;
+	// Whether values are loaded for the lives and items of `node`. No items are picked up during
+	// a load, so if a load's first decision is covered, so is every state it ends in.
+	bool covers(const Node &node) const;
+	int get_max_lives(void) const;
+	int get_max_items(void) const;
+
+	// Identifies the loaded values, 0 if none are loaded. Tablebases and solution caches record
+	// it, as every EV they hold depends on the evaluation they were solved with.
+	uint32_t get_fingerprint(void) const;
+
+	// Solves every covered state by value iteration and writes the result to `path`. Each
+	// iteration searches every fresh load once, scoring the loads it runs into with the values
+	// of the previous iteration, until no value changes by more than a thousandth of a point.
+	// Progress is reported on stdout.
+	bool generate(const std::string &path, int max_lives, int max_items);
+
+   private:
+	struct ReloadValuesHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t max_lives;
+		uint32_t max_items;
+		uint32_t reserved;
+		uint64_t entry_count;
+	};
+
+	void set_coverage(int max_lives, int max_items);
+	std::optional<std::size_t> get_index(const Node &node) const;
+	std::size_t get_entry_count(void) const;
+
+	int max_lives = 0;
+	ItemSetIndex item_set_index;
+	uint32_t fingerprint = 0;
+
+	const float *entries = nullptr;
+	std::vector<float> generated_entries;
+	void *mapping = nullptr;
+	std::size_t mapping_size = 0;
+};
+
+extern ReloadValues reload_values;
+
+#endif  // RELOAD_VALUES_HPP
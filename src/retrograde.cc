@@ -0,0 +1,227 @@
+#include "retrograde.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <limits>
+
+#include "reload.hpp"
+#include "search_stats.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+constexpr std::size_t INITIAL_SLOT_COUNT = 1 << 12;
+// Levels smaller than this are evaluated on the calling thread.
+constexpr int MIN_PARALLEL_LEVEL_SIZE = 16384;
+
+std::size_t get_slot(uint64_t key, std::size_t slot_count) {
+	return (key * 0x9E3779B97F4A7C15ull) >> (64 - __builtin_ctzll(slot_count));
+}
+}  // namespace
+
+int RetrogradeSolver::get_level(const Node &node) {
+	return node.get_live_round_count() + node.get_blank_round_count() +
+	       node.get_dealer_items().get_item_count() + node.get_player_items().get_item_count();
+}
+
+uint32_t RetrogradeSolver::add_state(const Node &node) {
+	if (2 * (this->states.size() + 1) > this->slot_keys.size()) {
+		std::vector<uint64_t> old_keys(this->slot_keys.size() * 2);
+		std::vector<uint32_t> old_states(old_keys.size());
+		old_keys.swap(this->slot_keys);
+		old_states.swap(this->slot_states);
+
+		for (std::size_t i = 0; i < old_keys.size(); i++) {
+			if (old_keys[i] == 0) {
+				continue;
+			}
+			std::size_t slot = get_slot(old_keys[i], this->slot_keys.size());
+			while (this->slot_keys[slot] != 0) {
+				slot = (slot + 1) & (this->slot_keys.size() - 1);
+			}
+			this->slot_keys[slot] = old_keys[i];
+			this->slot_states[slot] = old_states[i];
+		}
+	}
+
+	std::size_t slot = get_slot(node.state, this->slot_keys.size());
+	while (this->slot_keys[slot] != 0) {
+		if (this->slot_keys[slot] == node.state) {
+			return this->slot_states[slot];
+		}
+		slot = (slot + 1) & (this->slot_keys.size() - 1);
+	}
+
+	const uint32_t state_index = static_cast<uint32_t>(this->states.size());
+	this->slot_keys[slot] = node.state;
+	this->slot_states[slot] = state_index;
+	this->states.push_back(node);
+	return state_index;
+}
+
+void RetrogradeSolver::expand_state(uint32_t state_index) {
+	assert(this->successor_offsets.size() == state_index);
+	this->successor_offsets.push_back(static_cast<uint32_t>(this->successor_states.size()));
+
+	const Node node = this->states[state_index];
+	if (node.is_terminal() || node.is_reload_pending()) {
+		return;
+	}
+
+	MoveList moves;
+	if (node.is_dealer_turn()) {
+		node.generate_dealer_moves(moves);
+	}
+	else {
+		node.generate_player_moves(moves);
+	}
+
+	for (const Successor &successor : moves) {
+		SEARCH_STATS_INCREMENT(successor_copies);
+		Node child = node;
+		child.apply_outcome(successor.outcome);
+		// `add_state` may reallocate `states`, so `node` is a copy.
+		this->successor_states.push_back(this->add_state(child.get_canonical()));
+		this->successor_actions.push_back(successor.action);
+		this->successor_probabilities.push_back(successor.probability);
+	}
+}
+
+void RetrogradeSolver::evaluate_state(uint32_t state_index) {
+	SEARCH_STATS_INCREMENT(nodes_visited);
+	const Node &node = this->states[state_index];
+
+	if (node.is_terminal()) {
+		SEARCH_STATS_INCREMENT(terminal_nodes);
+		this->values[state_index] = node.eval();
+		return;
+	}
+	// The loads after a reload have more shells and items than the state itself, so they can't
+	// be part of the level order. They are searched recursively and memoized instead.
+	if (node.is_reload_pending()) {
+		this->values[state_index] = reload_table.get_value(node);
+		return;
+	}
+
+	SEARCH_STATS_INCREMENT(nodes_expanded);
+	const uint32_t begin = this->successor_offsets[state_index];
+	const uint32_t end = this->successor_offsets[state_index + 1];
+	float ev;
+
+	// Same summation order as Node::expectimax_on_turn, so both engines agree bit for bit.
+	if (node.is_dealer_turn()) {
+		SEARCH_STATS_INCREMENT(chance_nodes);
+		ev = 0.0f;
+		for (uint32_t i = begin; i < end; i++) {
+			ev += this->values[this->successor_states[i]] * this->successor_probabilities[i];
+		}
+	}
+	else {
+		SEARCH_STATS_INCREMENT(decision_nodes);
+		ev = std::numeric_limits<float>::lowest();
+		Action best_action = this->successor_actions[begin];
+		for (uint32_t i = begin; i < end;) {
+			const Action action = this->successor_actions[i];
+			float action_ev = 0.0f;
+			for (; i < end && this->successor_actions[i] == action; i++) {
+				action_ev +=
+				    this->values[this->successor_states[i]] * this->successor_probabilities[i];
+			}
+			if (action_ev > ev || (action_ev == ev && action < best_action)) {
+				ev = action_ev;
+				best_action = action;
+			}
+		}
+		this->best_actions[state_index] = best_action;
+	}
+	this->values[state_index] = ev;
+}
+
+ActionValues RetrogradeSolver::get_action_values(const Node &root) {
+	assert(root.is_player_turn());
+
+	// Buffers keep their capacity from the previous solve, so repeated solves of similar
+	// positions don't allocate or fault in fresh pages.
+	this->states.clear();
+	this->successor_offsets.clear();
+	this->successor_states.clear();
+	this->successor_actions.clear();
+	this->successor_probabilities.clear();
+	this->slot_keys.resize(std::max(this->slot_keys.size(), INITIAL_SLOT_COUNT));
+	this->slot_states.resize(this->slot_keys.size());
+	std::fill(this->slot_keys.begin(), this->slot_keys.end(), 0);
+
+	MoveList root_moves;
+	root.generate_player_moves(root_moves);
+	std::array<uint32_t, MAX_SUCCESSORS> root_successors;
+	for (int i = 0; i < root_moves.size(); i++) {
+		Node child = root;
+		child.apply_outcome(root_moves[i].outcome);
+		root_successors[i] = this->add_state(child.get_canonical());
+	}
+
+	// States are expanded in the order they were found, which keeps the successor lists in
+	// state order without a separate pass.
+	for (uint32_t state_index = 0; state_index < this->states.size(); state_index++) {
+		this->expand_state(state_index);
+	}
+	this->successor_offsets.push_back(static_cast<uint32_t>(this->successor_states.size()));
+
+	// Counting sort of the states by level.
+	this->levels.resize(this->states.size());
+	int max_level = 0;
+	for (std::size_t i = 0; i < this->states.size(); i++) {
+		this->levels[i] = get_level(this->states[i]);
+		max_level = std::max(this->levels[i], max_level);
+	}
+	this->level_offsets.assign(max_level + 2, 0);
+	for (int level : this->levels) {
+		this->level_offsets[level + 1]++;
+	}
+	for (int level = 0; level <= max_level; level++) {
+		this->level_offsets[level + 1] += this->level_offsets[level];
+	}
+	this->order.resize(this->states.size());
+	this->next_slot.assign(this->level_offsets.begin(), this->level_offsets.end() - 1);
+	for (uint32_t i = 0; i < this->states.size(); i++) {
+		this->order[this->next_slot[this->levels[i]]++] = i;
+	}
+
+	this->values.assign(this->states.size(), 0.0f);
+	this->best_actions.assign(this->states.size(), Action::SHOOT_DEALER);
+	const int thread_count = thread_pool.get_thread_count();
+	const int chunk_count = thread_count * 4;
+
+	for (int level = 0; level <= max_level; level++) {
+		const uint32_t level_begin = this->level_offsets[level];
+		const uint32_t level_size = this->level_offsets[level + 1] - level_begin;
+
+		if (level_size < MIN_PARALLEL_LEVEL_SIZE || thread_count == 1) {
+			for (uint32_t i = level_begin; i < level_begin + level_size; i++) {
+				this->evaluate_state(this->order[i]);
+			}
+			continue;
+		}
+
+		thread_pool.parallel_for(chunk_count, [&](int chunk) {
+			const uint32_t chunk_begin =
+			    level_begin + static_cast<uint64_t>(level_size) * chunk / chunk_count;
+			const uint32_t chunk_end =
+			    level_begin + static_cast<uint64_t>(level_size) * (chunk + 1) / chunk_count;
+			for (uint32_t i = chunk_begin; i < chunk_end; i++) {
+				this->evaluate_state(this->order[i]);
+			}
+		});
+	}
+
+	std::array<float, MAX_SUCCESSORS> successor_evs;
+	for (int i = 0; i < root_moves.size(); i++) {
+		successor_evs[i] = this->values[root_successors[i]];
+	}
+	return Node::rank_action_values(root_moves, successor_evs);
+}
+
+ActionValues solve_retrograde(const Node &root) {
+	thread_local RetrogradeSolver solver;
+	return solver.get_action_values(root);
+}
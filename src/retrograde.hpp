@@ -0,0 +1,64 @@
+#ifndef RETROGRADE_HPP
+#define RETROGRADE_HPP
+#include <cstdint>
+#include <vector>
+
+#include "expectimax.hpp"
+
+// Bottom-up solver for a single root position. Every move consumes a shell or an item, so the
+// state graph is a DAG ordered by the number of shells and items left. The solver enumerates the
+// canonical states reachable from the root once, stores their successors in flat arrays, and
+// evaluates them level by level in increasing order of that count, so every successor is final
+// before its parents read it. Evaluation neither recurses nor hashes, and the states of a level
+// are independent, so each level is spread over the thread pool.
+class RetrogradeSolver final {
+   public:
+	// Same contract as Node::get_action_values.
+	ActionValues get_action_values(const Node &root);
+	// Calls `visit(state, best_action, ev)` for every player decision reachable from the root of
+	// the last solve, in canonical form. The root itself is not included. Ties between actions go
+	// to the first one in `Action` order, like in `ActionValues`.
+	template <typename Visitor>
+	void for_each_decision(Visitor visit) const {
+		for (uint32_t i = 0; i < this->states.size(); i++) {
+			if (this->successor_offsets[i] < this->successor_offsets[i + 1] &&
+			    this->states[i].is_player_turn()) {
+				visit(this->states[i], this->best_actions[i], this->values[i]);
+			}
+		}
+	}
+
+   private:
+	uint32_t add_state(const Node &node);
+	void expand_state(uint32_t state_index);
+	void evaluate_state(uint32_t state_index);
+	static int get_level(const Node &node);
+
+	std::vector<Node> states;
+	// Successors of state `i` are `successor_states[successor_offsets[i]..successor_offsets[i+1])`,
+	// with their actions and probabilities at the same positions. Terminal states have none.
+	std::vector<uint32_t> successor_offsets;
+	std::vector<uint32_t> successor_states;
+	std::vector<Action> successor_actions;
+	std::vector<float> successor_probabilities;
+	std::vector<float> values;
+	// Best action of each player decision state, unset for the others.
+	std::vector<Action> best_actions;
+
+	// Counting sort of the states by level: `order[level_offsets[l]..level_offsets[l+1])` are the
+	// states of level `l`.
+	std::vector<int> levels;
+	std::vector<uint32_t> level_offsets;
+	std::vector<uint32_t> next_slot;
+	std::vector<uint32_t> order;
+
+	// Open-addressing index from packed state to state index, only used while enumerating.
+	// Packed states are never zero, which marks an empty slot.
+	std::vector<uint64_t> slot_keys;
+	std::vector<uint32_t> slot_states;
+};
+
+// Solves `root` with a solver owned by the calling thread, reusing its buffers across calls.
+ActionValues solve_retrograde(const Node &root);
+
+#endif  // RETROGRADE_HPP
@@ -0,0 +1,21 @@
+#include "search_budget.hpp"
+
+SearchBudget::SearchBudget(const SearchLimits &limits)
+    : deadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(limits.time_ms)),
+      has_deadline(limits.time_ms > 0),
+      max_nodes(limits.max_nodes) {}
+
+bool SearchBudget::charge_node(void) {
+	if (this->is_spent()) {
+		return true;
+	}
+
+	const uint64_t node_count = this->node_count.fetch_add(1, std::memory_order_relaxed) + 1;
+	if ((this->max_nodes > 0 && node_count > this->max_nodes) ||
+	    (this->has_deadline && node_count % CLOCK_CHECK_INTERVAL == 0 &&
+	     std::chrono::steady_clock::now() >= this->deadline)) {
+		this->spent.store(true, std::memory_order_relaxed);
+		return true;
+	}
+	return false;
+}
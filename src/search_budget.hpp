@@ -0,0 +1,67 @@
+#ifndef SEARCH_BUDGET_HPP
+#define SEARCH_BUDGET_HPP
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Limits on every root search of the recursive engine, 0 for none. With either one set, roots
+// are searched by iterative deepening and answered from the deepest iteration that finished
+// within the budget (see `Node::search_action_values`).
+struct SearchLimits {
+	int64_t time_ms = 0;
+	uint64_t max_nodes = 0;
+
+	bool is_limited(void) const { return this->time_ms > 0 || this->max_nodes > 0; }
+};
+
+extern SearchLimits search_limits;
+
+// The budget of one root search, shared by all threads working on it. Once it is spent every
+// node of the search returns at once, and the values it returns must be discarded.
+class SearchBudget final {
+   public:
+	explicit SearchBudget(const SearchLimits &limits);
+
+	SearchBudget(const SearchBudget &) = delete;
+	SearchBudget &operator=(const SearchBudget &) = delete;
+
+	// Counts one expanded node and returns true once the budget is spent. The clock is only read
+	// every CLOCK_CHECK_INTERVAL nodes, which keeps the check off the profile.
+	bool charge_node(void);
+	bool is_spent(void) const { return this->spent.load(std::memory_order_relaxed); }
+	uint64_t get_node_count(void) const {
+		return this->node_count.load(std::memory_order_relaxed);
+	}
+
+   private:
+	static constexpr uint64_t CLOCK_CHECK_INTERVAL = 256;
+
+	std::chrono::steady_clock::time_point deadline;
+	bool has_deadline;
+	uint64_t max_nodes;
+	std::atomic<uint64_t> node_count = 0;
+	std::atomic<bool> spent = false;
+};
+
+// The budget of the root search the calling thread works on, nullptr while it searches without
+// one. Constant-initialized in the header so the search reads it without a TLS wrapper call.
+inline thread_local SearchBudget *thread_search_budget = nullptr;
+
+// Sets the calling thread's budget for the lifetime of the scope. Root subtrees run as pool
+// tasks, possibly on a thread that is itself waiting inside another search, so the previous
+// budget is restored afterwards.
+class SearchBudgetScope final {
+   public:
+	explicit SearchBudgetScope(SearchBudget *budget) : saved_budget(thread_search_budget) {
+		thread_search_budget = budget;
+	}
+	~SearchBudgetScope() { thread_search_budget = this->saved_budget; }
+
+	SearchBudgetScope(const SearchBudgetScope &) = delete;
+	SearchBudgetScope &operator=(const SearchBudgetScope &) = delete;
+
+   private:
+	SearchBudget *saved_budget;
+};
+
+#endif  // SEARCH_BUDGET_HPP
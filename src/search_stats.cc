@@ -0,0 +1,142 @@
+#include "search_stats.hpp"
+
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+std::mutex registry_mutex;
+// Counters outlive their threads so that totals survive thread pool resizes.
+std::vector<std::unique_ptr<ThreadSearchCounters>> registry;
+std::array<double, ACTION_COUNT> action_ms = {};
+std::array<bool, ACTION_COUNT> action_searched = {};
+}  // namespace
+
+ThreadSearchCounters &get_thread_search_counters(void) {
+	thread_local ThreadSearchCounters *counters = [] {
+		std::lock_guard<std::mutex> lock(registry_mutex);
+		registry.emplace_back(std::make_unique<ThreadSearchCounters>());
+		return registry.back().get();
+	}();
+	return *counters;
+}
+
+SearchStats get_search_stats(void) {
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	SearchStats stats;
+
+	auto load = [](const std::atomic<uint64_t> &counter) {
+		return counter.load(std::memory_order_relaxed);
+	};
+
+	for (const std::unique_ptr<ThreadSearchCounters> &counters : registry) {
+		stats.nodes_visited += load(counters->nodes_visited);
+		stats.nodes_expanded += load(counters->nodes_expanded);
+		stats.decision_nodes += load(counters->decision_nodes);
+		stats.chance_nodes += load(counters->chance_nodes);
+		stats.terminal_nodes += load(counters->terminal_nodes);
+		stats.tablebase_hits += load(counters->tablebase_hits);
+		stats.policy_hits += load(counters->policy_hits);
+		stats.solution_cache_hits += load(counters->solution_cache_hits);
+		stats.reload_nodes += load(counters->reload_nodes);
+		stats.reload_expansions += load(counters->reload_expansions);
+		stats.reload_value_misses += load(counters->reload_value_misses);
+		stats.horizon_nodes += load(counters->horizon_nodes);
+		stats.deepening_iterations += load(counters->deepening_iterations);
+		stats.budget_stops += load(counters->budget_stops);
+		stats.chance_cutoffs += load(counters->chance_cutoffs);
+		stats.max_ev_cutoffs += load(counters->max_ev_cutoffs);
+		stats.tt_bound_hits += load(counters->tt_bound_hits);
+		stats.successor_copies += load(counters->successor_copies);
+		stats.tt_probes += load(counters->tt_probes);
+		stats.tt_hits += load(counters->tt_hits);
+		stats.tt_stores += load(counters->tt_stores);
+		stats.tt_overwrites += load(counters->tt_overwrites);
+		stats.tt_evictions += load(counters->tt_evictions);
+		stats.tt_second_chances += load(counters->tt_second_chances);
+		for (int depth = 0; depth < MAX_TRACKED_DEPTH; depth++) {
+			stats.nodes_per_depth[depth] += load(counters->nodes_per_depth[depth]);
+		}
+	}
+	stats.action_ms = action_ms;
+	stats.action_searched = action_searched;
+	return stats;
+}
+
+void reset_search_stats(void) {
+	std::lock_guard<std::mutex> lock(registry_mutex);
+
+	for (const std::unique_ptr<ThreadSearchCounters> &counters : registry) {
+		for (std::atomic<uint64_t> *counter :
+		     {&counters->nodes_visited, &counters->nodes_expanded, &counters->decision_nodes,
+		      &counters->chance_nodes, &counters->terminal_nodes, &counters->tablebase_hits,
+		      &counters->policy_hits, &counters->solution_cache_hits, &counters->reload_nodes,
+		      &counters->reload_expansions, &counters->reload_value_misses,
+		      &counters->horizon_nodes,
+		      &counters->deepening_iterations, &counters->budget_stops,
+		      &counters->chance_cutoffs, &counters->max_ev_cutoffs, &counters->tt_bound_hits,
+		      &counters->successor_copies, &counters->tt_probes,
+		      &counters->tt_hits, &counters->tt_stores, &counters->tt_overwrites,
+		      &counters->tt_evictions, &counters->tt_second_chances}) {
+			counter->store(0, std::memory_order_relaxed);
+		}
+		for (std::atomic<uint64_t> &counter : counters->nodes_per_depth) {
+			counter.store(0, std::memory_order_relaxed);
+		}
+	}
+	action_ms.fill(0.0);
+	action_searched.fill(false);
+}
+
+void record_action_time(Action action, double ms) {
+	std::lock_guard<std::mutex> lock(registry_mutex);
+	action_ms[static_cast<int>(action)] += ms;
+	action_searched[static_cast<int>(action)] = true;
+}
+
+void print_search_stats(std::ostream &out, const SearchStats &stats) {
+#ifndef SEARCH_STATS_ENABLED
+	out << "[STATS] Search statistics are disabled in this build.\n";
+	return;
+#endif
+	const double hit_rate =
+	    stats.tt_probes > 0 ? 100.0 * stats.tt_hits / static_cast<double>(stats.tt_probes) : 0.0;
+
+	out << "[STATS] Nodes: " << stats.nodes_visited << " visited, " << stats.nodes_expanded
+	    << " expanded (" << stats.decision_nodes << " decision, " << stats.chance_nodes
+	    << " chance), " << stats.terminal_nodes << " terminal, " << stats.tablebase_hits
+	    << " tablebase hits, " << stats.policy_hits << " policy hits, "
+	    << stats.solution_cache_hits << " solution cache hits, " << stats.successor_copies
+	    << " successor copies.\n";
+	out << "[STATS] Reloads: " << stats.reload_nodes << " chance nodes, "
+	    << stats.reload_expansions << " computed, " << stats.reload_value_misses
+	    << " loads outside the reload values.\n";
+	out << "[STATS] Deepening: " << stats.deepening_iterations << " iterations, "
+	    << stats.horizon_nodes << " horizon nodes, " << stats.budget_stops
+	    << " searches stopped by the budget.\n";
+	out << "[STATS] Pruning: " << stats.chance_cutoffs << " chance node cutoffs, "
+	    << stats.max_ev_cutoffs << " nodes below the window, " << stats.tt_bound_hits
+	    << " upper bound hits.\n";
+	out << "[STATS] Transposition table: " << stats.tt_probes << " probes, " << stats.tt_hits
+	    << " hits (" << std::fixed << std::setprecision(1) << hit_rate << std::defaultfloat
+	    << "%), " << stats.tt_stores << " stores, " << stats.tt_overwrites << " overwrites, "
+	    << stats.tt_evictions << " evictions, " << stats.tt_second_chances
+	    << " second chances.\n";
+
+	out << "[STATS] Nodes per depth:";
+	for (int depth = 0; depth < MAX_TRACKED_DEPTH; depth++) {
+		if (stats.nodes_per_depth[depth] > 0) {
+			out << ' ' << depth + 1 << '=' << stats.nodes_per_depth[depth];
+		}
+	}
+	out << '\n';
+
+	for (int action = 0; action < ACTION_COUNT; action++) {
+		if (stats.action_searched[action]) {
+			out << "[STATS] Time for '" << action_to_str(static_cast<Action>(action))
+			    << "': " << std::fixed << std::setprecision(3) << stats.action_ms[action]
+			    << std::defaultfloat << " ms.\n";
+		}
+	}
+}
@@ -0,0 +1,190 @@
+#ifndef SEARCH_STATS_HPP
+#define SEARCH_STATS_HPP
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+#include "expectimax.hpp"
+
+// Search instrumentation. Counting is compiled in only when SEARCH_STATS_ENABLED is defined (the
+// ENABLE_SEARCH_STATS CMake option); otherwise the macros and scopes below expand to nothing and
+// `get_search_stats` returns zeros.
+//
+// Each thread increments its own set of counters, so counting never contends; `get_search_stats`
+// sums the sets of all threads that ever searched.
+
+constexpr int MAX_TRACKED_DEPTH = 64;
+
+struct SearchStats {
+	uint64_t nodes_visited = 0;
+	uint64_t nodes_expanded = 0;
+	uint64_t decision_nodes = 0;
+	uint64_t chance_nodes = 0;
+	uint64_t terminal_nodes = 0;
+	uint64_t tablebase_hits = 0;
+	// Root positions answered by the loaded policy and by the on-disk solution cache without
+	// searching.
+	uint64_t policy_hits = 0;
+	uint64_t solution_cache_hits = 0;
+	// Empty-shotgun chance nodes reached with reloads left, and how many of them had to be
+	// computed instead of being found in the reload table.
+	uint64_t reload_nodes = 0;
+	uint64_t reload_expansions = 0;
+	// Loads scored by the life difference because their lives or items lie outside the loaded
+	// reload values.
+	uint64_t reload_value_misses = 0;
+	// Nodes scored by `eval` at the depth limit of a limited search, root iterations completed
+	// by iterative deepening, and root searches whose budget ran out before an exact iteration.
+	uint64_t horizon_nodes = 0;
+	uint64_t deepening_iterations = 0;
+	uint64_t budget_stops = 0;
+	// Chance nodes cut off once their EV could no longer beat the window, nodes whose highest
+	// reachable EV couldn't beat it, and probes answered by an upper bound entry.
+	uint64_t chance_cutoffs = 0;
+	uint64_t max_ev_cutoffs = 0;
+	uint64_t tt_bound_hits = 0;
+	// Successor states built from their parent, one per searched outcome.
+	uint64_t successor_copies = 0;
+	uint64_t tt_probes = 0;
+	uint64_t tt_hits = 0;
+	uint64_t tt_stores = 0;
+	// Stores that replaced an entry of the same state.
+	uint64_t tt_overwrites = 0;
+	// Stores that replaced an entry of a different state.
+	uint64_t tt_evictions = 0;
+	// Referenced entries spared by an eviction.
+	uint64_t tt_second_chances = 0;
+	// Visited nodes by ply below the root. The last bucket also counts everything deeper.
+	std::array<uint64_t, MAX_TRACKED_DEPTH> nodes_per_depth = {};
+	// Wall time spent solving the subtrees of each root action, summed over all threads.
+	std::array<double, ACTION_COUNT> action_ms = {};
+	std::array<bool, ACTION_COUNT> action_searched = {};
+};
+
+struct ThreadSearchCounters {
+	std::atomic<uint64_t> nodes_visited = 0;
+	std::atomic<uint64_t> nodes_expanded = 0;
+	std::atomic<uint64_t> decision_nodes = 0;
+	std::atomic<uint64_t> chance_nodes = 0;
+	std::atomic<uint64_t> terminal_nodes = 0;
+	std::atomic<uint64_t> tablebase_hits = 0;
+	std::atomic<uint64_t> policy_hits = 0;
+	std::atomic<uint64_t> solution_cache_hits = 0;
+	std::atomic<uint64_t> reload_nodes = 0;
+	std::atomic<uint64_t> reload_expansions = 0;
+	std::atomic<uint64_t> reload_value_misses = 0;
+	std::atomic<uint64_t> horizon_nodes = 0;
+	std::atomic<uint64_t> deepening_iterations = 0;
+	std::atomic<uint64_t> budget_stops = 0;
+	std::atomic<uint64_t> chance_cutoffs = 0;
+	std::atomic<uint64_t> max_ev_cutoffs = 0;
+	std::atomic<uint64_t> tt_bound_hits = 0;
+	std::atomic<uint64_t> successor_copies = 0;
+	std::atomic<uint64_t> tt_probes = 0;
+	std::atomic<uint64_t> tt_hits = 0;
+	std::atomic<uint64_t> tt_stores = 0;
+	std::atomic<uint64_t> tt_overwrites = 0;
+	std::atomic<uint64_t> tt_evictions = 0;
+	std::atomic<uint64_t> tt_second_chances = 0;
+	std::array<std::atomic<uint64_t>, MAX_TRACKED_DEPTH> nodes_per_depth = {};
+	// Current ply of the search running on this thread. Only touched by the owning thread.
+	int ply = 0;
+};
+
+ThreadSearchCounters &get_thread_search_counters(void);
+SearchStats get_search_stats(void);
+void reset_search_stats(void);
+void record_action_time(Action action, double ms);
+void print_search_stats(std::ostream &out, const SearchStats &stats);
+
+// Only the owning thread writes its counters, so a relaxed load and store is enough and avoids a
+// locked read-modify-write on the hot path.
+inline void increment_counter(std::atomic<uint64_t> &counter) {
+	counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+#ifdef SEARCH_STATS_ENABLED
+
+#define SEARCH_STATS_INCREMENT(counter) increment_counter(get_thread_search_counters().counter)
+
+// Marks one node visit for the lifetime of the scope and tracks its ply.
+class SearchPlyScope final {
+   public:
+	SearchPlyScope() : counters(get_thread_search_counters()) {
+		counters.ply++;
+		increment_counter(counters.nodes_visited);
+		increment_counter(
+		    counters.nodes_per_depth[std::min(counters.ply, MAX_TRACKED_DEPTH) - 1]);
+	}
+	~SearchPlyScope() { counters.ply--; }
+
+   private:
+	ThreadSearchCounters &counters;
+};
+
+// Ply of the node the calling thread is searching, 0 at the root.
+inline int get_search_ply(void) { return get_thread_search_counters().ply; }
+
+// Continues ply counting at `ply` in a pool task that searches a subtree of a node at that ply.
+// Tasks may run on a thread that is itself waiting inside another search, so the thread's own
+// ply is restored afterwards.
+class SearchTaskScope final {
+   public:
+	explicit SearchTaskScope(int ply)
+	    : counters(get_thread_search_counters()), saved_ply(counters.ply) {
+		counters.ply = ply;
+	}
+	~SearchTaskScope() { counters.ply = saved_ply; }
+
+   private:
+	ThreadSearchCounters &counters;
+	int saved_ply;
+};
+
+// Adds the lifetime of the scope to the time spent on `action` at the root.
+class ActionTimer final {
+   public:
+	explicit ActionTimer(Action action)
+	    : action(action), start(std::chrono::steady_clock::now()) {}
+	~ActionTimer() {
+		const auto end = std::chrono::steady_clock::now();
+		record_action_time(this->action,
+		                   std::chrono::duration<double, std::milli>(end - this->start).count());
+	}
+
+   private:
+	Action action;
+	std::chrono::steady_clock::time_point start;
+};
+
+#else
+
+#define SEARCH_STATS_INCREMENT(counter) ((void)0)
+
+// The scopes keep a user-provided constructor and destructor, so that the compiler doesn't warn
+// about them as unused variables.
+class SearchPlyScope final {
+   public:
+	SearchPlyScope() {}
+	~SearchPlyScope() {}
+};
+
+inline int get_search_ply(void) { return 0; }
+
+class SearchTaskScope final {
+   public:
+	explicit SearchTaskScope(int) {}
+	~SearchTaskScope() {}
+};
+
+class ActionTimer final {
+   public:
+	explicit ActionTimer(Action) {}
+};
+
+#endif
+
+#endif  // SEARCH_STATS_HPP
@@ -0,0 +1,187 @@
+#include "server.hpp"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "batch.hpp"
+#include "position_format.hpp"
+
+namespace {
+// Longest accepted request line. Positions are about 25 characters, so anything much longer is
+// not a position and the connection is dropped instead of buffering it.
+constexpr std::size_t MAX_REQUEST_LINE_LENGTH = 1024;
+constexpr int LISTEN_BACKLOG = 64;
+
+// Accepted connections waiting for a free connection worker.
+struct ConnectionQueue {
+	std::mutex mutex;
+	std::condition_variable connection_ready;
+	std::deque<int> connections;
+};
+
+bool send_all(int fd, const std::string &data) {
+	std::size_t sent = 0;
+	while (sent < data.size()) {
+		// MSG_NOSIGNAL turns a client that hung up into an error instead of a SIGPIPE.
+		const ssize_t result = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+		if (result < 0 && errno == EINTR) {
+			continue;
+		}
+		if (result <= 0) {
+			return false;
+		}
+		sent += result;
+	}
+	return true;
+}
+
+std::string answer_line(const std::string &line, bool report) {
+	std::string error;
+	const std::optional<Node> node = parse_position(line, error);
+	if (!node) {
+		return "error\t" + error + '\n';
+	}
+
+	// Running out of memory in one request must not take down the server and every other
+	// client with it.
+	std::ostringstream answer;
+	try {
+		write_answer(answer, solve_for_answer(node.value(), report), report);
+	}
+	catch (const std::bad_alloc &) {
+		return "error\tout of memory\n";
+	}
+	answer << '\n';
+	return answer.str();
+}
+
+// Answers the requests of one client until it closes the connection. Every batch of complete
+// lines that arrives together is answered with a single send.
+void serve_connection(int fd, bool report) {
+	std::string pending;
+	char buffer[4096];
+
+	for (;;) {
+		const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+		if (received < 0 && errno == EINTR) {
+			continue;
+		}
+		if (received <= 0) {
+			break;
+		}
+		pending.append(buffer, received);
+
+		std::string answers;
+		std::size_t line_start = 0;
+		for (std::size_t line_end = pending.find('\n'); line_end != std::string::npos;
+		     line_start = line_end + 1, line_end = pending.find('\n', line_start)) {
+			std::string line = pending.substr(line_start, line_end - line_start);
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+			if (!line.empty() && line[0] != '#') {
+				answers += answer_line(line, report);
+			}
+		}
+		pending.erase(0, line_start);
+
+		if (!answers.empty() && !send_all(fd, answers)) {
+			break;
+		}
+		if (pending.size() > MAX_REQUEST_LINE_LENGTH) {
+			send_all(fd, "error\trequest line too long\n");
+			break;
+		}
+	}
+	close(fd);
+}
+
+void connection_worker_loop(ConnectionQueue &queue, bool report) {
+	for (;;) {
+		int fd;
+		{
+			std::unique_lock<std::mutex> lock(queue.mutex);
+			queue.connection_ready.wait(lock, [&] { return !queue.connections.empty(); });
+			fd = queue.connections.front();
+			queue.connections.pop_front();
+		}
+		serve_connection(fd, report);
+	}
+}
+
+// Removes `socket_path` if it is a socket, which can only be left over from an earlier server.
+// Anything else at that path is kept, so that bind fails instead of deleting a user's file.
+void remove_stale_socket(const std::string &socket_path) {
+	struct stat file_stat;
+	if (lstat(socket_path.c_str(), &file_stat) == 0 && S_ISSOCK(file_stat.st_mode)) {
+		unlink(socket_path.c_str());
+	}
+}
+}  // namespace
+
+bool run_server(const std::string &socket_path, int connection_worker_count, bool report) {
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (socket_path.size() >= sizeof(address.sun_path)) {
+		std::cout << "[ERROR] Socket path '" << socket_path << "' is too long.\n";
+		return false;
+	}
+	std::memcpy(address.sun_path, socket_path.c_str(), socket_path.size() + 1);
+
+	const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0) {
+		std::cout << "[ERROR] Failed to create socket: " << std::strerror(errno) << ".\n";
+		return false;
+	}
+
+	remove_stale_socket(socket_path);
+	if (bind(listen_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+	    listen(listen_fd, LISTEN_BACKLOG) != 0) {
+		std::cout << "[ERROR] Failed to listen on '" << socket_path
+		          << "': " << std::strerror(errno) << ".\n";
+		close(listen_fd);
+		return false;
+	}
+
+	ConnectionQueue queue;
+	std::vector<std::thread> connection_workers;
+	for (int i = 0; i < connection_worker_count; i++) {
+		connection_workers.emplace_back(connection_worker_loop, std::ref(queue), report);
+	}
+	std::cout << "[INFO] Listening on '" << socket_path << "' with " << connection_worker_count
+	          << " connection workers." << std::endl;
+
+	for (;;) {
+		const int fd = accept(listen_fd, nullptr, nullptr);
+		if (fd < 0) {
+			if (errno != EINTR && errno != ECONNABORTED) {
+				// Out of file descriptors or similar; retrying right away would spin.
+				std::cout << "[ERROR] Failed to accept a connection: " << std::strerror(errno)
+				          << ".\n";
+				std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			}
+			continue;
+		}
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			queue.connections.push_back(fd);
+		}
+		queue.connection_ready.notify_one();
+	}
+}
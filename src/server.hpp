@@ -0,0 +1,19 @@
+#ifndef SERVER_HPP
+#define SERVER_HPP
+
+#include <string>
+
+constexpr int DEFAULT_SERVER_CONNECTION_WORKERS = 8;
+
+// Listens on the Unix domain socket at `socket_path` and answers every line a client sends with
+// the line batch mode would print for it (see batch.hpp): a client writes positions in the
+// format of position_format.hpp and reads one "<action>\t<ev>" or "error\t<message>" line back
+// per position, in order. Empty lines and lines starting with '#' get no answer.
+//
+// Clients are served by `connection_worker_count` threads, one connection per thread at a time.
+// Their searches share the thread pool, the warm transposition table and the solution cache. A
+// stale socket file left behind by an earlier server is replaced. Only returns if the socket
+// can't be set up.
+bool run_server(const std::string &socket_path, int connection_worker_count, bool report);
+
+#endif  // SERVER_HPP
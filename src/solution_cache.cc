@@ -0,0 +1,186 @@
+#include "solution_cache.hpp"
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "reload_values.hpp"
+#include "transposition_table.hpp"
+
+namespace {
+constexpr char SOLUTION_CACHE_MAGIC[8] = {'B', 'R', 'S', 'C', 'A', 'C', 'H', 'E'};
+// Bump whenever the node packing or the EVs of positions change, e.g. when the evaluation or
+// the game rules change.
+constexpr uint32_t SOLUTION_CACHE_VERSION = 2;
+// Slots probed after the home slot of a key before a store replaces the home slot.
+constexpr std::size_t SOLUTION_CACHE_PROBE_COUNT = 8;
+
+uint64_t pack_slot_data(Action action, float ev) {
+	uint32_t ev_bits;
+	std::memcpy(&ev_bits, &ev, sizeof(ev_bits));
+	return static_cast<uint64_t>(ev_bits) | static_cast<uint64_t>(action) << 32;
+}
+
+std::size_t get_home_slot(uint64_t key, std::size_t slot_count) {
+	return (key * 0x9E3779B97F4A7C15ull) >> (64 - __builtin_ctzll(slot_count));
+}
+
+// Creates the header and the empty table if the file is still empty. Holds an exclusive lock
+// meanwhile, so of several processes opening a new file at once only the first one sizes it.
+bool initialize_file(int fd, const void *header, std::size_t header_size, off_t file_size) {
+	if (flock(fd, LOCK_EX) != 0) {
+		return false;
+	}
+
+	struct stat file_stat;
+	bool initialized = fstat(fd, &file_stat) == 0;
+	if (initialized && file_stat.st_size == 0) {
+		initialized = ftruncate(fd, file_size) == 0 &&
+		              pwrite(fd, header, header_size, 0) == static_cast<ssize_t>(header_size);
+	}
+
+	flock(fd, LOCK_UN);
+	return initialized;
+}
+}  // namespace
+
+SolutionCache::~SolutionCache() { this->close(); }
+
+bool SolutionCache::open(const std::string &path, std::size_t size_bytes) {
+	this->close();
+
+	const std::size_t max_slot_count =
+	    size_bytes > sizeof(SolutionCacheHeader)
+	        ? (size_bytes - sizeof(SolutionCacheHeader)) / sizeof(Slot)
+	        : 0;
+	// At least two slots, so that the home slot always takes some bits of the key.
+	std::size_t slot_count = 2;
+	while (slot_count * 2 <= max_slot_count) {
+		slot_count *= 2;
+	}
+
+	SolutionCacheHeader new_header = {};
+	std::memcpy(new_header.magic, SOLUTION_CACHE_MAGIC, sizeof(SOLUTION_CACHE_MAGIC));
+	new_header.version = SOLUTION_CACHE_VERSION;
+	new_header.eval_fingerprint = reload_values.get_fingerprint();
+	new_header.slot_count = slot_count;
+
+	const int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		return false;
+	}
+	if (!initialize_file(fd, &new_header, sizeof(new_header),
+	                     sizeof(new_header) + slot_count * sizeof(Slot))) {
+		::close(fd);
+		return false;
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 ||
+	    static_cast<std::size_t>(file_stat.st_size) < sizeof(SolutionCacheHeader)) {
+		::close(fd);
+		return false;
+	}
+
+	const std::size_t size = file_stat.st_size;
+	void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (mapping == MAP_FAILED) {
+		return false;
+	}
+
+	SolutionCacheHeader header;
+	std::memcpy(&header, mapping, sizeof(header));
+
+	if (std::memcmp(header.magic, SOLUTION_CACHE_MAGIC, sizeof(SOLUTION_CACHE_MAGIC)) != 0 ||
+	    header.version != SOLUTION_CACHE_VERSION ||
+	    header.eval_fingerprint != reload_values.get_fingerprint() || header.slot_count < 2 ||
+	    (header.slot_count & (header.slot_count - 1)) != 0 ||
+	    size != sizeof(SolutionCacheHeader) + header.slot_count * sizeof(Slot)) {
+		munmap(mapping, size);
+		return false;
+	}
+
+	this->mapping = mapping;
+	this->mapping_size = size;
+	this->slots = reinterpret_cast<Slot *>(static_cast<char *>(mapping) + sizeof(header));
+	this->slot_count = header.slot_count;
+	return true;
+}
+
+void SolutionCache::close(void) {
+	if (this->mapping != nullptr) {
+		munmap(this->mapping, this->mapping_size);
+	}
+	this->slots = nullptr;
+	this->slot_count = 0;
+	this->mapping = nullptr;
+	this->mapping_size = 0;
+}
+
+bool SolutionCache::is_open(void) const { return this->slots != nullptr; }
+
+std::optional<std::pair<Action, float>> SolutionCache::probe(const Node &node) const {
+	if (this->slots == nullptr) {
+		return std::nullopt;
+	}
+
+	const uint64_t key = std::hash<Node>{}(node);
+	const std::size_t home = get_home_slot(key, this->slot_count);
+	const std::size_t probe_count = std::min(SOLUTION_CACHE_PROBE_COUNT, this->slot_count);
+
+	for (std::size_t i = 0; i < probe_count; i++) {
+		const Slot &slot = this->slots[(home + i) & (this->slot_count - 1)];
+		const uint64_t data = slot.data.load(std::memory_order_relaxed);
+		const uint64_t slot_key = slot.key_xor_data.load(std::memory_order_relaxed) ^ data;
+		if (slot_key == 0) {
+			break;
+		}
+		if (slot_key != key) {
+			continue;
+		}
+
+		const uint32_t ev_bits = static_cast<uint32_t>(data);
+		const int action_index = static_cast<uint8_t>(data >> 32);
+		if (action_index >= ACTION_COUNT) {
+			return std::nullopt;
+		}
+		float ev;
+		std::memcpy(&ev, &ev_bits, sizeof(ev));
+		return std::make_pair(static_cast<Action>(action_index), ev);
+	}
+	return std::nullopt;
+}
+
+void SolutionCache::store(const Node &node, Action action, float ev) {
+	if (this->slots == nullptr) {
+		return;
+	}
+
+	const uint64_t key = std::hash<Node>{}(node);
+	const std::size_t home = get_home_slot(key, this->slot_count);
+	const std::size_t probe_count = std::min(SOLUTION_CACHE_PROBE_COUNT, this->slot_count);
+
+	// Take the slot of the same position or the first empty one. When the probed run is full the
+	// home slot is replaced; every cached position costs a full search to recompute, so there is
+	// no cheaper victim to prefer.
+	Slot *target = &this->slots[home];
+	for (std::size_t i = 0; i < probe_count; i++) {
+		Slot &slot = this->slots[(home + i) & (this->slot_count - 1)];
+		const uint64_t data = slot.data.load(std::memory_order_relaxed);
+		const uint64_t slot_key = slot.key_xor_data.load(std::memory_order_relaxed) ^ data;
+		if (slot_key == key || slot_key == 0) {
+			target = &slot;
+			break;
+		}
+	}
+
+	const uint64_t data = pack_slot_data(action, ev);
+	target->key_xor_data.store(key ^ data, std::memory_order_relaxed);
+	target->data.store(data, std::memory_order_relaxed);
+}
@@ -0,0 +1,67 @@
+#ifndef SOLUTION_CACHE_HPP
+#define SOLUTION_CACHE_HPP
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+
+#include "expectimax.hpp"
+
+constexpr std::size_t DEFAULT_SOLUTION_CACHE_SIZE_BYTES = 64 * 1024 * 1024;
+
+// Best actions and exact EVs of solved root positions, kept in a memory-mapped file so that they
+// survive the process and are shared by every process that opens the same file. The file is a
+// fixed header followed by an open-addressing hash table keyed by the packed node state. Slots
+// are read and written with plain atomic stores on the shared mapping, and like the
+// transposition table every slot stores its key XORed with its data, so a slot torn by two
+// processes writing at once reads as a miss instead of a wrong answer.
+//
+// File layout:
+//   SolutionCacheHeader
+//   Slot slots[slot_count]
+class SolutionCache final {
+   public:
+	SolutionCache() = default;
+	~SolutionCache();
+
+	SolutionCache(const SolutionCache &) = delete;
+	SolutionCache &operator=(const SolutionCache &) = delete;
+
+	// Maps the file at `path`, creating it with room for `size_bytes` if it doesn't exist yet.
+	// An existing file keeps its own size. Returns false (and leaves the cache closed) if the file
+	// can't be created or mapped, was written by an incompatible version or holds EVs solved with
+	// other reload values than the loaded ones (see reload_values.hpp).
+	bool open(const std::string &path, std::size_t size_bytes);
+	void close(void);
+	bool is_open(void) const;
+	std::optional<std::pair<Action, float>> probe(const Node &node) const;
+	void store(const Node &node, Action action, float ev);
+
+   private:
+	struct SolutionCacheHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t eval_fingerprint;
+		uint64_t slot_count;
+		uint64_t reserved_2;
+	};
+
+	// Data bits:
+	//   0-31: EV as raw float bits.
+	//   32-39: best action.
+	struct Slot {
+		std::atomic<uint64_t> key_xor_data;
+		std::atomic<uint64_t> data;
+	};
+
+	Slot *slots = nullptr;
+	std::size_t slot_count = 0;
+	void *mapping = nullptr;
+	std::size_t mapping_size = 0;
+};
+
+extern SolutionCache solution_cache;
+
+#endif  // SOLUTION_CACHE_HPP
@@ -0,0 +1,60 @@
+#include "state_index.hpp"
+
+int get_lives_index(int max_lives, int dealer_lives, int player_lives) {
+	int tier_offset;
+	switch (max_lives) {
+		case 2:
+			tier_offset = 0;
+			break;
+		case 4:
+			tier_offset = 4;
+			break;
+		case 6:
+			tier_offset = 20;
+			break;
+		default:
+			return -1;
+	}
+	if (dealer_lives < 1 || dealer_lives > max_lives || player_lives < 1 ||
+	    player_lives > max_lives) {
+		return -1;
+	}
+	return tier_offset + (dealer_lives - 1) * max_lives + (player_lives - 1);
+}
+
+void ItemSetIndex::set_max_items(int max_items) {
+	this->max_items = max_items;
+
+	int radix_count = 1;
+	for (int i = 0; i < ITEM_KIND_COUNT; i++) {
+		radix_count *= max_items + 1;
+	}
+	this->indices.assign(radix_count, -1);
+	this->item_sets.clear();
+	for (int radix_index = 0; radix_index < radix_count; radix_index++) {
+		int counts[ITEM_KIND_COUNT];
+		int item_count = 0;
+		int rest = radix_index;
+		for (int i = ITEM_KIND_COUNT - 1; i >= 0; i--) {
+			counts[i] = rest % (max_items + 1);
+			item_count += counts[i];
+			rest /= max_items + 1;
+		}
+		if (item_count <= max_items) {
+			this->indices[radix_index] = static_cast<int>(this->item_sets.size());
+			this->item_sets.emplace_back(counts[0], counts[1], counts[2], counts[3], counts[4]);
+		}
+	}
+}
+
+int ItemSetIndex::get_index(const ItemManager &items) const {
+	int radix_index = 0;
+	for (int i = 0; i < ITEM_KIND_COUNT; i++) {
+		const int count = items.get_count(static_cast<Item>(i));
+		if (count > this->max_items) {
+			return -1;
+		}
+		radix_index = radix_index * (this->max_items + 1) + count;
+	}
+	return this->indices[radix_index];
+}
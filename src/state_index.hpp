@@ -0,0 +1,35 @@
+#ifndef STATE_INDEX_HPP
+#define STATE_INDEX_HPP
+#include <vector>
+
+#include "item_manager.hpp"
+
+// (dealer lives, player lives) pairs over all max lives tiers: 2 * 2 + 4 * 4 + 6 * 6.
+constexpr int LIVES_STATE_COUNT = 56;
+
+// Dense index of a lives pair below LIVES_STATE_COUNT, or -1 if either side is dead or the pair
+// doesn't fit `max_lives`.
+int get_lives_index(int max_lives, int dealer_lives, int player_lives);
+
+// Dense index over the item sets holding at most `max_items` items in total, for the tables
+// that store a value per item set of each side.
+class ItemSetIndex final {
+   public:
+	ItemSetIndex() { this->set_max_items(0); }
+
+	void set_max_items(int max_items);
+	int get_max_items(void) const { return this->max_items; }
+	int get_count(void) const { return static_cast<int>(this->item_sets.size()); }
+
+	// -1 if `items` holds more than `max_items` items.
+	int get_index(const ItemManager &items) const;
+	ItemManager get_items(int index) const { return this->item_sets[index]; }
+
+   private:
+	int max_items = 0;
+	// indices[mixed radix item counts], -1 if not covered, and its inverse.
+	std::vector<int> indices;
+	std::vector<ItemManager> item_sets;
+};
+
+#endif  // STATE_INDEX_HPP
@@ -0,0 +1,258 @@
+#include "tablebase.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include "reload_values.hpp"
+#include "state_index.hpp"
+#include "thread_pool.hpp"
+
+namespace {
+constexpr char TABLEBASE_MAGIC[8] = {'B', 'R', 'S', 'T', 'B', 'A', 'S', 'E'};
+constexpr uint32_t TABLEBASE_VERSION = 1;
+
+// is_dealer_turn * known round (unknown, live, blank) * handsaw_applied * handcuffs_applied *
+// handcuffs_available.
+constexpr int FLAG_STATE_COUNT = 2 * 3 * 2 * 2 * 2;
+}  // namespace
+
+Tablebase::~Tablebase() { this->unload(); }
+
+void Tablebase::set_coverage(int max_shells, int max_items) {
+	this->max_shells = max_shells;
+	this->max_items = max_items;
+
+	this->shell_indices.assign((max_shells + 1) * (max_shells + 1), -1);
+	this->shell_state_count = 0;
+	for (int shell_count = 1; shell_count <= max_shells; shell_count++) {
+		for (int live = 0; live <= shell_count; live++) {
+			this->shell_indices[live * (max_shells + 1) + (shell_count - live)] =
+			    this->shell_state_count++;
+		}
+	}
+
+	this->item_set_index.set_max_items(max_items);
+}
+
+std::size_t Tablebase::get_entry_count(void) const {
+	return static_cast<std::size_t>(LIVES_STATE_COUNT) * this->shell_state_count *
+	       FLAG_STATE_COUNT * this->item_set_index.get_count() *
+	       this->item_set_index.get_count();
+}
+
+std::optional<std::size_t> Tablebase::get_index(const Node &node) const {
+	const int live = node.get_live_round_count();
+	const int blank = node.get_blank_round_count();
+	if (live > this->max_shells || blank > this->max_shells) {
+		return std::nullopt;
+	}
+	const int shell_index = this->shell_indices[live * (this->max_shells + 1) + blank];
+	if (shell_index < 0) {
+		return std::nullopt;
+	}
+
+	const int dealer_item_index = this->item_set_index.get_index(node.get_dealer_items());
+	const int player_item_index = this->item_set_index.get_index(node.get_player_items());
+	if (dealer_item_index < 0 || player_item_index < 0) {
+		return std::nullopt;
+	}
+
+	const int lives_index =
+	    get_lives_index(node.get_max_lives(), node.get_dealer_lives(), node.get_player_lives());
+	if (lives_index < 0) {
+		return std::nullopt;
+	}
+
+	const int known_round = node.round_known_live() ? 1 : (node.round_known_blank() ? 2 : 0);
+	const int flag_index = node.is_dealer_turn() * 24 + known_round * 8 +
+	                       node.is_handsaw_applied() * 4 + node.is_handcuffs_applied() * 2 +
+	                       node.is_handcuffs_available();
+
+	std::size_t index = lives_index;
+	index = index * this->shell_state_count + shell_index;
+	index = index * FLAG_STATE_COUNT + flag_index;
+	index = index * this->item_set_index.get_count() + dealer_item_index;
+	index = index * this->item_set_index.get_count() + player_item_index;
+	return index;
+}
+
+std::optional<float> Tablebase::probe(const Node &node) const {
+	// Tablebase states end with their load, so they say nothing about positions with reloads.
+	if (this->entries == nullptr || node.get_reloads_left() != 0) {
+		return std::nullopt;
+	}
+
+	const std::optional<std::size_t> index = this->get_index(node);
+	if (!index) {
+		return std::nullopt;
+	}
+
+	const float ev = this->entries[index.value()];
+	if (std::isnan(ev)) {
+		return std::nullopt;
+	}
+	return ev;
+}
+
+bool Tablebase::is_loaded(void) const { return this->entries != nullptr; }
+
+uint32_t Tablebase::get_eval_fingerprint(void) const { return this->eval_fingerprint; }
+
+bool Tablebase::load(const std::string &path) {
+	this->unload();
+
+	const int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	struct stat file_stat;
+	if (fstat(fd, &file_stat) != 0 ||
+	    static_cast<std::size_t>(file_stat.st_size) < sizeof(TablebaseHeader)) {
+		close(fd);
+		return false;
+	}
+
+	const std::size_t size = file_stat.st_size;
+	void *mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		return false;
+	}
+
+	TablebaseHeader header;
+	std::memcpy(&header, mapping, sizeof(header));
+
+	if (std::memcmp(header.magic, TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC)) != 0 ||
+	    header.version != TABLEBASE_VERSION || header.max_shells > 8 || header.max_items > 8) {
+		munmap(mapping, size);
+		return false;
+	}
+
+	this->set_coverage(header.max_shells, header.max_items);
+	if (header.entry_count != this->get_entry_count() ||
+	    size != sizeof(TablebaseHeader) + header.entry_count * sizeof(float)) {
+		munmap(mapping, size);
+		this->set_coverage(0, 0);
+		return false;
+	}
+
+	this->mapping = mapping;
+	this->mapping_size = size;
+	this->entries = reinterpret_cast<const float *>(static_cast<const char *>(mapping) +
+	                                                sizeof(TablebaseHeader));
+	this->eval_fingerprint = header.eval_fingerprint;
+	return true;
+}
+
+void Tablebase::unload(void) {
+	if (this->mapping != nullptr) {
+		munmap(this->mapping, this->mapping_size);
+	}
+	this->mapping = nullptr;
+	this->mapping_size = 0;
+	this->entries = nullptr;
+	this->eval_fingerprint = 0;
+	this->generated_entries.clear();
+	this->generated_entries.shrink_to_fit();
+	this->set_coverage(0, 0);
+}
+
+bool Tablebase::generate(const std::string &path, int max_shells, int max_items) {
+	this->unload();
+	this->set_coverage(max_shells, max_items);
+	this->generated_entries.assign(this->get_entry_count(),
+	                               std::numeric_limits<float>::quiet_NaN());
+	this->entries = this->generated_entries.data();
+
+	// Inverse mapping from the dense shell indices back to the shell counts.
+	std::vector<std::pair<int, int>> shell_states(this->shell_state_count);
+	for (int live = 0; live <= max_shells; live++) {
+		for (int blank = 0; blank + live <= max_shells; blank++) {
+			const int shell_index = this->shell_indices[live * (max_shells + 1) + blank];
+			if (shell_index >= 0) {
+				shell_states[shell_index] = {live, blank};
+			}
+		}
+	}
+
+	// Every transition consumes a shell or an item, so solving states in order of increasing
+	// shells + items guarantees that all successors of a state are already in the table.
+	const int max_level = max_shells + 2 * max_items;
+	for (int level = 1; level <= max_level; level++) {
+		std::vector<std::array<int, 3>> level_states;
+		for (int shell_index = 0; shell_index < this->shell_state_count; shell_index++) {
+			for (int dealer_index = 0; dealer_index < this->item_set_index.get_count();
+			     dealer_index++) {
+				for (int player_index = 0; player_index < this->item_set_index.get_count();
+				     player_index++) {
+					const auto [live, blank] = shell_states[shell_index];
+					if (live + blank +
+					        this->item_set_index.get_items(dealer_index).get_item_count() +
+					        this->item_set_index.get_items(player_index).get_item_count() ==
+					    level) {
+						level_states.push_back({shell_index, dealer_index, player_index});
+					}
+				}
+			}
+		}
+
+		thread_pool.parallel_for(static_cast<int>(level_states.size()), [&](int i) {
+			const auto [shell_index, dealer_index, player_index] = level_states[i];
+			const auto [live, blank] = shell_states[shell_index];
+
+			for (int max_lives = 2; max_lives <= 6; max_lives += 2) {
+				for (int dealer_lives = 1; dealer_lives <= max_lives; dealer_lives++) {
+					for (int player_lives = 1; player_lives <= max_lives; player_lives++) {
+						for (int flag_index = 0; flag_index < FLAG_STATE_COUNT; flag_index++) {
+							const int known_round = flag_index / 8 % 3;
+							Node node(flag_index / 24, known_round == 1, known_round == 2, live,
+							          blank, max_lives, dealer_lives, player_lives,
+							          this->item_set_index.get_items(dealer_index),
+							          this->item_set_index.get_items(player_index));
+							node.set_handsaw_applied(flag_index / 4 % 2);
+							node.set_handcuffs_applied(flag_index / 2 % 2);
+							node.set_handcuffs_available(flag_index % 2);
+
+							// Impossible states are left empty. A known round that isn't in the
+							// chamber would make the search loop on itself.
+							if ((node.round_known_live() && live == 0) ||
+							    (node.round_known_blank() && blank == 0) ||
+							    (node.is_handcuffs_applied() && !node.is_handcuffs_available())) {
+								continue;
+							}
+
+							const std::size_t index = this->get_index(node).value();
+							this->generated_entries[index] = node.expectimax();
+						}
+					}
+				}
+			}
+		});
+
+		std::cout << "[INFO] Solved level " << level << '/' << max_level << " ("
+		          << level_states.size() << " shell and item combinations).\n";
+	}
+
+	TablebaseHeader header = {};
+	std::memcpy(header.magic, TABLEBASE_MAGIC, sizeof(TABLEBASE_MAGIC));
+	header.version = TABLEBASE_VERSION;
+	header.max_shells = max_shells;
+	header.max_items = max_items;
+	header.eval_fingerprint = reload_values.get_fingerprint();
+	header.entry_count = this->generated_entries.size();
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(this->generated_entries.data()),
+	           this->generated_entries.size() * sizeof(float));
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,75 @@
+#ifndef TABLEBASE_HPP
+#define TABLEBASE_HPP
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "expectimax.hpp"
+#include "state_index.hpp"
+
+constexpr int DEFAULT_TABLEBASE_MAX_SHELLS = 4;
+constexpr int DEFAULT_TABLEBASE_MAX_ITEMS = 2;
+
+// Precomputed EVs of every state with at most `max_shells` shells left and at most `max_items`
+// items per side. The file is a fixed header followed by one float per state, addressed by a
+// perfect index over the state fields, and is memory-mapped so loading it parses nothing.
+//
+// File layout:
+//   TablebaseHeader
+//   float entries[entry_count]  (NaN for impossible states)
+class Tablebase final {
+   public:
+	Tablebase() = default;
+	~Tablebase();
+
+	Tablebase(const Tablebase &) = delete;
+	Tablebase &operator=(const Tablebase &) = delete;
+
+	// Maps the file at `path`. Returns false (and leaves the tablebase empty) if the file can't
+	// be mapped or was not written by a compatible generator.
+	bool load(const std::string &path);
+	void unload(void);
+	bool is_loaded(void) const;
+	std::optional<float> probe(const Node &node) const;
+	// Fingerprint of the reload values the entries were solved with (see reload_values.hpp), 0
+	// for the plain evaluation. Probing with different values loaded mixes two evaluations.
+	uint32_t get_eval_fingerprint(void) const;
+
+	// Solves every covered state bottom-up and writes the result to `path`. While generating,
+	// the partially filled table is probed by the search, so each state only recurses one ply
+	// into already solved states. Progress is reported on stdout.
+	bool generate(const std::string &path, int max_shells, int max_items);
+
+   private:
+	struct TablebaseHeader {
+		char magic[8];
+		uint32_t version;
+		uint32_t max_shells;
+		uint32_t max_items;
+		uint32_t eval_fingerprint;
+		uint64_t entry_count;
+	};
+
+	void set_coverage(int max_shells, int max_items);
+	std::optional<std::size_t> get_index(const Node &node) const;
+	std::size_t get_entry_count(void) const;
+
+	int max_shells = 0;
+	int max_items = 0;
+	uint32_t eval_fingerprint = 0;
+	// shell_indices[live][blank], -1 if not covered.
+	std::vector<int> shell_indices;
+	int shell_state_count = 0;
+	ItemSetIndex item_set_index;
+
+	const float *entries = nullptr;
+	std::vector<float> generated_entries;
+	void *mapping = nullptr;
+	std::size_t mapping_size = 0;
+};
+
+extern Tablebase tablebase;
+
+#endif  // TABLEBASE_HPP
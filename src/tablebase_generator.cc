@@ -0,0 +1,105 @@
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "cli_utils.hpp"
+#include "reload_values.hpp"
+#include "tablebase.hpp"
+#include "thread_pool.hpp"
+#include "transposition_table.hpp"
+
+void print_usage(std::string_view program_name) {
+	std::cout << "Usage: " << program_name << " [options]\n"
+	          << "Options:\n"
+	          << "  --output <path>     Output file (default tablebase.bin).\n"
+	          << "  --max-shells <n>    Largest live + blank count covered (default "
+	          << DEFAULT_TABLEBASE_MAX_SHELLS << ").\n"
+	          << "  --max-items <n>     Largest item count per side covered (default "
+	          << DEFAULT_TABLEBASE_MAX_ITEMS << ").\n"
+	          << "  --reload-values <path>\n"
+	          << "                      Reload values to solve with (see reload-value-generator).\n"
+	          << "                      The solver has to load the same file to probe the result.\n"
+	          << "  --threads <n>       Number of solver threads (default 1).\n"
+	          << "  --tt-mb <size>      Transposition table size in megabytes (default "
+	          << DEFAULT_TRANSPOSITION_TABLE_SIZE_MB << ").\n"
+	          << "  --help              Show this message.\n";
+}
+
+int main(int argc, char **argv) {
+	std::string output_path = "tablebase.bin";
+	int max_shells = DEFAULT_TABLEBASE_MAX_SHELLS;
+	int max_items = DEFAULT_TABLEBASE_MAX_ITEMS;
+
+	for (int i = 1; i < argc; i++) {
+		std::string_view arg = argv[i];
+		std::optional<int> value;
+
+		if (arg == "--help") {
+			print_usage(argv[0]);
+			return 0;
+		}
+		if (arg == "--output" && i + 1 < argc) {
+			output_path = argv[++i];
+			continue;
+		}
+		if (arg == "--max-shells" && i + 1 < argc) {
+			value = parse_int(argv[++i]);
+			if (!value || value.value() < 1 || value.value() > 8) {
+				std::cout << "[ERROR] Invalid shell count '" << argv[i] << "' (1-8).\n";
+				return 1;
+			}
+			max_shells = value.value();
+			continue;
+		}
+		if (arg == "--max-items" && i + 1 < argc) {
+			value = parse_int(argv[++i]);
+			if (!value || value.value() < 0 || value.value() > 8) {
+				std::cout << "[ERROR] Invalid item count '" << argv[i] << "' (0-8).\n";
+				return 1;
+			}
+			max_items = value.value();
+			continue;
+		}
+		if (arg == "--reload-values" && i + 1 < argc) {
+			if (!reload_values.load(argv[++i])) {
+				std::cout << "[ERROR] Failed to load reload values '" << argv[i] << "'.\n";
+				return 1;
+			}
+			continue;
+		}
+		if (arg == "--threads" && i + 1 < argc) {
+			value = parse_int(argv[++i]);
+			if (!value || value.value() < 1 || value.value() > 256) {
+				std::cout << "[ERROR] Invalid thread count '" << argv[i] << "'.\n";
+				return 1;
+			}
+			thread_pool.resize(value.value());
+			continue;
+		}
+		if (arg == "--tt-mb" && i + 1 < argc) {
+			value = parse_int(argv[++i]);
+			if (!value || value.value() < 1) {
+				std::cout << "[ERROR] Invalid transposition table size '" << argv[i] << "'.\n";
+				return 1;
+			}
+			if (!tt_manager.resize(value.value())) {
+				std::cout << "[ERROR] Not enough memory for a transposition table of " << argv[i]
+				          << " MB.\n";
+				return 1;
+			}
+			continue;
+		}
+
+		std::cout << "[ERROR] Unknown option '" << arg << "'.\n";
+		print_usage(argv[0]);
+		return 1;
+	}
+
+	if (!tablebase.generate(output_path, max_shells, max_items)) {
+		std::cout << "[ERROR] Failed to write '" << output_path << "'.\n";
+		return 1;
+	}
+	std::cout << "[INFO] Wrote tablebase to '" << output_path << "'.\n";
+	return 0;
+}
@@ -0,0 +1,145 @@
+#include "thread_pool.hpp"
+
+#include <cassert>
+#include <optional>
+
+namespace {
+// Index of the queue owned by the current thread. Threads outside of the pool share queue 0.
+thread_local int worker_queue_index = 0;
+}  // namespace
+
+ThreadPool::ThreadPool(int thread_count) { this->resize(thread_count); }
+
+ThreadPool::~ThreadPool() { this->stop_workers(); }
+
+void ThreadPool::resize(int thread_count) {
+	assert(thread_count >= 1);
+	this->stop_workers();
+
+	this->queues.clear();
+	for (int i = 0; i < thread_count; i++) {
+		this->queues.emplace_back(std::make_unique<WorkerQueue>());
+	}
+
+	this->stopping = false;
+	for (int i = 1; i < thread_count; i++) {
+		this->workers.emplace_back(&ThreadPool::worker_loop, this, i);
+	}
+}
+
+void ThreadPool::WorkerQueue::push_back(const Task &task) {
+	if (this->size == this->tasks.size()) {
+		std::vector<Task> grown(this->tasks.size() * 2);
+		for (std::size_t i = 0; i < this->size; i++) {
+			grown[i] = this->tasks[(this->front + i) & (this->tasks.size() - 1)];
+		}
+		this->tasks.swap(grown);
+		this->front = 0;
+	}
+	this->tasks[(this->front + this->size++) & (this->tasks.size() - 1)] = task;
+}
+
+ThreadPool::Task ThreadPool::WorkerQueue::pop_back(void) {
+	assert(this->size > 0);
+	return this->tasks[(this->front + --this->size) & (this->tasks.size() - 1)];
+}
+
+ThreadPool::Task ThreadPool::WorkerQueue::pop_front(void) {
+	assert(this->size > 0);
+	const Task task = this->tasks[this->front];
+	this->front = (this->front + 1) & (this->tasks.size() - 1);
+	this->size--;
+	return task;
+}
+
+int ThreadPool::get_thread_count(void) const { return static_cast<int>(this->queues.size()); }
+
+void ThreadPool::run_batch(int task_count, TaskFn fn, const void *context) {
+	if (this->workers.empty() || task_count <= 1) {
+		for (int i = 0; i < task_count; i++) {
+			fn(context, i);
+		}
+		return;
+	}
+
+	const int queue_index = worker_queue_index;
+	std::atomic<int> pending = task_count;
+	WorkerQueue &queue = *this->queues[queue_index];
+
+	// The calling thread runs task 0 right away and pops the rest from the back of its own queue,
+	// so tasks are pushed in reverse and idle workers steal the highest indices first.
+	{
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		for (int i = task_count - 1; i >= 1; i--) {
+			queue.push_back({fn, context, i, &pending});
+		}
+	}
+	{
+		std::lock_guard<std::mutex> lock(this->sleep_mutex);
+		this->queued_task_count.fetch_add(task_count - 1);
+	}
+	this->wake_workers.notify_all();
+
+	fn(context, 0);
+	pending.fetch_sub(1, std::memory_order_acq_rel);
+
+	while (pending.load(std::memory_order_acquire) > 0) {
+		if (!this->try_run_task(queue_index)) {
+			std::this_thread::yield();
+		}
+	}
+}
+
+bool ThreadPool::try_run_task(int queue_index) {
+	std::optional<Task> task;
+	const int queue_count = static_cast<int>(this->queues.size());
+
+	for (int i = 0; i < queue_count && !task; i++) {
+		WorkerQueue &queue = *this->queues[(queue_index + i) % queue_count];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+
+		if (queue.size == 0) {
+			continue;
+		}
+		task = i == 0 ? queue.pop_back() : queue.pop_front();
+	}
+
+	if (!task) {
+		return false;
+	}
+
+	this->queued_task_count.fetch_sub(1);
+	task->fn(task->context, task->index);
+	task->pending->fetch_sub(1, std::memory_order_acq_rel);
+	return true;
+}
+
+void ThreadPool::worker_loop(int queue_index) {
+	worker_queue_index = queue_index;
+
+	for (;;) {
+		if (this->try_run_task(queue_index)) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(this->sleep_mutex);
+		this->wake_workers.wait(
+		    lock, [this] { return this->stopping || this->queued_task_count.load() > 0; });
+		if (this->stopping) {
+			return;
+		}
+	}
+}
+
+void ThreadPool::stop_workers(void) {
+	{
+		std::lock_guard<std::mutex> lock(this->sleep_mutex);
+		this->stopping = true;
+	}
+	this->wake_workers.notify_all();
+
+	for (std::thread &worker : this->workers) {
+		worker.join();
+	}
+	this->workers.clear();
+}
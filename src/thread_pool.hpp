@@ -0,0 +1,79 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a task queue: it pops its own tasks from the back
+// and steals from the front of the other queues when it runs dry. A thread that waits for a batch
+// keeps executing queued tasks instead of blocking, so batches may be nested (a task may start a
+// batch of its own) without deadlocking.
+class ThreadPool final {
+   public:
+	explicit ThreadPool(int thread_count = 1);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	// `thread_count` includes the thread that calls `parallel_for`, so a count of 1 runs
+	// everything inline. Must not be called while a batch is running.
+	void resize(int thread_count);
+	int get_thread_count(void) const;
+
+	// Calls `fn(i)` for every `i` in [0, task_count) and returns once all calls have finished.
+	template <typename Fn>
+	void parallel_for(int task_count, const Fn &fn) {
+		this->run_batch(
+		    task_count,
+		    [](const void *context, int index) { (*static_cast<const Fn *>(context))(index); },
+		    &fn);
+	}
+
+   private:
+	using TaskFn = void (*)(const void *context, int index);
+
+	struct Task {
+		TaskFn fn;
+		const void *context;
+		int index;
+		std::atomic<int> *pending;
+	};
+
+	// Ring buffer of tasks. Unlike a deque, which allocates and frees blocks as tasks are pushed
+	// at one end and stolen from the other, it reuses its slots and only allocates to grow.
+	struct WorkerQueue {
+		std::mutex mutex;
+		std::vector<Task> tasks = std::vector<Task>(INITIAL_QUEUE_CAPACITY);
+		std::size_t front = 0;
+		std::size_t size = 0;
+
+		void push_back(const Task &task);
+		Task pop_back(void);
+		Task pop_front(void);
+	};
+
+	static constexpr std::size_t INITIAL_QUEUE_CAPACITY = 64;
+
+	void run_batch(int task_count, TaskFn fn, const void *context);
+	bool try_run_task(int queue_index);
+	void worker_loop(int queue_index);
+	void stop_workers(void);
+
+	// Queue 0 is shared by all threads that are not part of the pool.
+	std::vector<std::unique_ptr<WorkerQueue>> queues;
+	std::vector<std::thread> workers;
+
+	std::mutex sleep_mutex;
+	std::condition_variable wake_workers;
+	std::atomic<int> queued_task_count = 0;
+	bool stopping = false;
+};
+
+extern ThreadPool thread_pool;
+
+#endif  // THREAD_POOL_HPP
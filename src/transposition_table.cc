@@ -1,38 +1,263 @@
 #include "transposition_table.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <new>
 #include <optional>
 
+#include "search_stats.hpp"
+
 std::size_t std::hash<Node>::operator()(const Node &node) const {
-	return static_cast<std::size_t>(node.dealer_items.items & 0xFFFFF) |
-	       (static_cast<std::size_t>(node.player_items.items & 0xFFFFF) << 20) |
-	       (static_cast<std::size_t>(node.live_round_count & 0xF) << 40) |
-	       (static_cast<std::size_t>(node.blank_round_count & 0xF) << 44) |
-	       (static_cast<std::size_t>(node.max_lives & 0b111) << 48) |
-	       (static_cast<std::size_t>(node.dealer_lives & 0b111) << 51) |
-	       (static_cast<std::size_t>(node.player_lives & 0b111) << 54) |
-	       (static_cast<std::size_t>(node.is_dealer_turn & 0b1) << 57) |
-	       (static_cast<std::size_t>(node.curr_is_live & 0b1) << 58) |
-	       (static_cast<std::size_t>(node.curr_is_blank & 0b1) << 59) |
-	       (static_cast<std::size_t>(node.handsaw_applied & 0b1) << 60) |
-	       (static_cast<std::size_t>(node.handcuffs_applied & 0b1) << 61) |
-	       (static_cast<std::size_t>(node.handcuffs_available & 0b1) << 62);
+	return static_cast<std::size_t>(node.state);
+}
+
+TranspositionTableManager::TranspositionTableManager(std::size_t size_mb) { this->resize(size_mb); }
+
+bool TranspositionTableManager::resize(std::size_t size_mb) {
+	if (size_mb > std::numeric_limits<std::size_t>::max() / (1024 * 1024)) {
+		return false;
+	}
+	return this->resize_bytes(size_mb * 1024 * 1024);
+}
+
+bool TranspositionTableManager::resize_bytes(std::size_t size_bytes) {
+	const std::size_t max_bucket_count = std::max<std::size_t>(size_bytes / sizeof(Bucket), 1);
+	std::size_t bucket_count = 1;
+	int index_bits = 0;
+	while (bucket_count * 2 <= max_bucket_count) {
+		bucket_count *= 2;
+		index_bits++;
+	}
+
+	// The new table is built before it replaces the old one, which is kept if that fails.
+	try {
+		this->buckets = std::vector<Bucket>(bucket_count);
+	}
+	catch (const std::bad_alloc &) {
+		return false;
+	}
+	this->index_shift = 64 - index_bits;
+	return true;
+}
+
+std::size_t TranspositionTableManager::get_capacity(void) const {
+	return this->buckets.size() * TRANSPOSITION_TABLE_BUCKET_SIZE;
+}
+
+std::size_t TranspositionTableManager::get_size_bytes(void) const {
+	return this->buckets.size() * sizeof(Bucket);
+}
+
+double TranspositionTableManager::get_usage(void) const {
+	// Sampling the first buckets is enough, as keys are spread evenly over the table.
+	const std::size_t sampled_bucket_count = std::min<std::size_t>(this->buckets.size(), 4096);
+	std::size_t used_entry_count = 0;
+	for (std::size_t i = 0; i < sampled_bucket_count; i++) {
+		for (const Entry &entry : this->buckets[i].entries) {
+			used_entry_count += (entry.key_xor_data.load(std::memory_order_relaxed) ^
+			                     entry.data.load(std::memory_order_relaxed)) != 0;
+		}
+	}
+	return static_cast<double>(used_entry_count) /
+	       (sampled_bucket_count * TRANSPOSITION_TABLE_BUCKET_SIZE);
+}
+
+TranspositionTableManager::Bucket &TranspositionTableManager::get_bucket(uint64_t key) {
+	// Fibonacci hashing spreads the packed fields over the high bits, which select the bucket.
+	const uint64_t mixed = key * 0x9E3779B97F4A7C15ull;
+	return this->buckets[this->index_shift == 64 ? 0 : mixed >> this->index_shift];
+}
+
+namespace {
+uint64_t pack_entry_data(float ev, uint8_t depth, uint8_t generation, uint8_t draft,
+                         EvBound bound, std::optional<Action> best_action) {
+	uint32_t ev_bits;
+	std::memcpy(&ev_bits, &ev, sizeof(ev_bits));
+	const uint64_t action_bits = best_action ? static_cast<uint64_t>(*best_action) + 1 : 0;
+	return static_cast<uint64_t>(ev_bits) | static_cast<uint64_t>(depth) << 32 |
+	       static_cast<uint64_t>(generation) << 40 | static_cast<uint64_t>(draft) << 49 |
+	       static_cast<uint64_t>(bound == EvBound::UPPER) << 57 | action_bits << 58;
+}
+
+float get_entry_ev(uint64_t data) {
+	const uint32_t ev_bits = static_cast<uint32_t>(data);
+	float ev;
+	std::memcpy(&ev, &ev_bits, sizeof(ev));
+	return ev;
+}
+
+uint8_t get_entry_depth(uint64_t data) { return static_cast<uint8_t>(data >> 32); }
+
+uint8_t get_entry_generation(uint64_t data) { return static_cast<uint8_t>(data >> 40); }
+
+uint8_t get_entry_draft(uint64_t data) { return static_cast<uint8_t>(data >> 49); }
+
+EvBound get_entry_bound(uint64_t data) {
+	return data >> 57 & 1 ? EvBound::UPPER : EvBound::EXACT;
+}
+
+std::optional<Action> get_entry_best_action(uint64_t data) {
+	const int action_bits = static_cast<int>(data >> 58 & 0x7);
+	if (action_bits == 0) {
+		return std::nullopt;
+	}
+	return static_cast<Action>(action_bits - 1);
+}
+
+constexpr uint64_t REFERENCED_BIT = 1ull << 48;
+
+bool is_entry_referenced(uint64_t data) { return data & REFERENCED_BIT; }
+
+// The entry as it should look after a hit in `generation`.
+uint64_t get_touched_entry(uint64_t data, uint8_t generation) {
+	return (data & ~(0xFFull << 40)) | static_cast<uint64_t>(generation) << 40 | REFERENCED_BIT;
 }
+}  // namespace
+
+void TranspositionTableManager::add_node(const Node &node, float ev, int draft, EvBound bound,
+                                         std::optional<Action> best_action) {
+	const uint64_t key = std::hash<Node>{}(node);
+	const uint8_t depth =
+	    static_cast<uint8_t>(node.get_live_round_count() + node.get_blank_round_count());
+	const uint8_t generation = this->generation.load(std::memory_order_relaxed);
+	Bucket &bucket = this->get_bucket(key);
+
+	// Reuse the slot holding the same state, otherwise an empty slot. Otherwise each bucket
+	// runs a clock: entries that were hit since the clock last passed them are spared once and
+	// lose their reference bit, and among the rest the entry with the fewest shells left is
+	// evicted. Every generation an entry has gone untouched counts as much as a full load of
+	// shells, so stale entries from earlier searches go before anything the current search
+	// stored. Depth-limited entries only serve the iterations of one search and upper bounds
+	// only serve probes with a high enough `alpha`, so either counts as a generation older. If
+	// every entry was referenced, all of them lose the bit and compete on priority.
+	auto replace_priority = [generation](uint64_t data) {
+		const int age = static_cast<uint8_t>(generation - get_entry_generation(data)) +
+		                (get_entry_draft(data) != UNLIMITED_DEPTH ||
+		                 get_entry_bound(data) != EvBound::EXACT);
+		return get_entry_depth(data) - age * 8;
+	};
+
+	Entry *replace = nullptr;
+	uint64_t replace_key = 0;
+	int replace_score = std::numeric_limits<int>::max();
+	bool replace_referenced = true;
+	for (Entry &entry : bucket.entries) {
+		const uint64_t data = entry.data.load(std::memory_order_relaxed);
+		const uint64_t entry_key = entry.key_xor_data.load(std::memory_order_relaxed) ^ data;
 
-void TranspositionTableManager::add_node(const Node &node, float ev) {
-	if (this->transposition_table.size() == TRANSPOSITION_TABLE_MAX_SIZE) {
-		auto it = this->transposition_table.begin();
-		this->transposition_table.erase(it);
+		if (entry_key == key || entry_key == 0) {
+			replace = &entry;
+			replace_key = entry_key;
+			break;
+		}
+		const bool referenced = is_entry_referenced(data);
+		const int score = replace_priority(data);
+		if (replace == nullptr || (replace_referenced && !referenced) ||
+		    (replace_referenced == referenced && score < replace_score)) {
+			replace = &entry;
+			replace_key = entry_key;
+			replace_score = score;
+			replace_referenced = referenced;
+		}
 	}
 
-	this->transposition_table[node] = ev;
+	if (replace_key != key && replace_key != 0) {
+		for (Entry &entry : bucket.entries) {
+			const uint64_t data = entry.data.load(std::memory_order_relaxed);
+			if (&entry != replace && is_entry_referenced(data)) {
+				const uint64_t entry_key =
+				    entry.key_xor_data.load(std::memory_order_relaxed) ^ data;
+				entry.key_xor_data.store(entry_key ^ (data & ~REFERENCED_BIT),
+				                         std::memory_order_relaxed);
+				entry.data.store(data & ~REFERENCED_BIT, std::memory_order_relaxed);
+				SEARCH_STATS_INCREMENT(tt_second_chances);
+			}
+		}
+	}
+
+	SEARCH_STATS_INCREMENT(tt_stores);
+	if (replace_key == key) {
+		SEARCH_STATS_INCREMENT(tt_overwrites);
+	}
+	else if (replace_key != 0) {
+		SEARCH_STATS_INCREMENT(tt_evictions);
+	}
+
+	const uint64_t data = pack_entry_data(ev, depth, generation, static_cast<uint8_t>(draft),
+	                                      bound, best_action);
+	replace->key_xor_data.store(key ^ data, std::memory_order_relaxed);
+	replace->data.store(data, std::memory_order_relaxed);
+}
+
+TranspositionTableManager::Entry *TranspositionTableManager::find_entry(uint64_t key,
+                                                                         uint64_t &data) {
+	for (Entry &entry : this->get_bucket(key).entries) {
+		data = entry.data.load(std::memory_order_relaxed);
+		if ((entry.key_xor_data.load(std::memory_order_relaxed) ^ data) == key) {
+			return &entry;
+		}
+	}
+	return nullptr;
+}
+
+void TranspositionTableManager::touch_entry(Entry &entry, uint64_t key, uint64_t data) {
+	// Only write when the generation or the reference bit actually changes, so hot entries do
+	// not bounce between the caches of threads that keep hitting them.
+	const uint64_t touched =
+	    get_touched_entry(data, this->generation.load(std::memory_order_relaxed));
+	if (touched != data) {
+		entry.key_xor_data.store(key ^ touched, std::memory_order_relaxed);
+		entry.data.store(touched, std::memory_order_relaxed);
+	}
+}
+
+std::optional<float> TranspositionTableManager::get_ev(const Node &node, int min_draft,
+                                                       float alpha,
+                                                       std::optional<Action> &best_action) {
+	const uint64_t key = std::hash<Node>{}(node);
+	SEARCH_STATS_INCREMENT(tt_probes);
+
+	uint64_t data;
+	Entry *entry = this->find_entry(key, data);
+	if (entry == nullptr) {
+		return std::nullopt;
+	}
+	best_action = get_entry_best_action(data);
+
+	// A state has at most one entry, so a shallower one is a miss, and so is an upper bound
+	// above `alpha`, which says nothing about whether the EV beats it.
+	if (get_entry_draft(data) < min_draft) {
+		return std::nullopt;
+	}
+	const bool is_bound = get_entry_bound(data) == EvBound::UPPER;
+	if (is_bound && get_entry_ev(data) > alpha) {
+		return std::nullopt;
+	}
+
+	this->touch_entry(*entry, key, data);
+	SEARCH_STATS_INCREMENT(tt_hits);
+	if (is_bound) {
+		SEARCH_STATS_INCREMENT(tt_bound_hits);
+	}
+	return get_entry_ev(data);
+}
+
+void TranspositionTableManager::clear_table(void) {
+	for (Bucket &bucket : this->buckets) {
+		for (Entry &entry : bucket.entries) {
+			entry.key_xor_data.store(0, std::memory_order_relaxed);
+			entry.data.store(0, std::memory_order_relaxed);
+		}
+	}
 }
 
-std::optional<float> TranspositionTableManager::get_ev(const Node &node) {
-	auto match = this->transposition_table.find(node);
-	if (match != this->transposition_table.end()) {
-		return match->second;
+void TranspositionTableManager::new_search(void) {
+	if (!this->persistent) {
+		this->clear_table();
+		return;
 	}
-	return std::nullopt;
+	this->generation.fetch_add(1, std::memory_order_relaxed);
 }
 
-void TranspositionTableManager::clear_table(void) { this->transposition_table.clear(); }
+void TranspositionTableManager::set_persistent(bool persistent) { this->persistent = persistent; }
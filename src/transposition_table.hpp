@@ -1,9 +1,12 @@
 #ifndef TRANSPOSITION_TABLE_HPP
 #define TRANSPOSITION_TABLE_HPP
+#include <array>
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <functional>
 #include <optional>
-#include <unordered_map>
+#include <vector>
 
 #include "expectimax.hpp"
 
@@ -12,18 +15,89 @@ struct std::hash<Node> {
 	std::size_t operator()(const Node &node) const;
 };
 
-constexpr int TRANSPOSITION_TABLE_MAX_SIZE = 65'535;
+constexpr std::size_t DEFAULT_TRANSPOSITION_TABLE_SIZE_MB = 64;
+constexpr int TRANSPOSITION_TABLE_BUCKET_SIZE = 4;
 
+// What a stored EV says about the state. A search that failed low against its `alpha` only
+// proves the EV is at most the stored value.
+enum class EvBound : uint8_t {
+	EXACT,
+	UPPER,
+};
+
+// Shared by all search threads without locking. Probes and stores may race; a torn entry is
+// detected on the next probe and treated as a miss.
 class TranspositionTableManager {
    public:
-	TranspositionTableManager() = default;
+	explicit TranspositionTableManager(
+	    std::size_t size_mb = DEFAULT_TRANSPOSITION_TABLE_SIZE_MB);
 
-	void add_node(const Node &node, float ev);
-	std::optional<float> get_ev(const Node &node);
+	// Reallocates the table to the largest power-of-two bucket count that fits into `size_mb`
+	// megabytes (or `size_bytes` bytes). All stored entries are lost. Returns false, keeping the
+	// current table, if the memory can't be allocated.
+	bool resize(std::size_t size_mb);
+	bool resize_bytes(std::size_t size_bytes);
+	std::size_t get_capacity(void) const;
+	std::size_t get_size_bytes(void) const;
+	// Fraction of entries in use, estimated from a sample of the buckets.
+	double get_usage(void) const;
+	// `draft` is the depth the EV was searched to, UNLIMITED_DEPTH for exact EVs. A probe only
+	// hits entries searched at least `min_draft` deep, so depth-limited EVs never stand in for
+	// deeper or exact ones. An upper bound entry only hits probes whose `alpha` it doesn't
+	// exceed, where it fails low just like the search it came from.
+	//
+	// Decision nodes also store the action that scored `ev`. A probe returns it through
+	// `best_action` whenever the state has an entry, hit or not, as the action to try first.
+	void add_node(const Node &node, float ev, int draft, EvBound bound,
+	              std::optional<Action> best_action);
+	std::optional<float> get_ev(const Node &node, int min_draft, float alpha,
+	                            std::optional<Action> &best_action);
 	void clear_table(void);
+	// Called once per root search. In persistent mode the stored EVs are kept (they are exact,
+	// so they stay valid for any later search) and only the generation counter is advanced,
+	// which lets entries that were not touched recently age out first. Otherwise the table is
+	// cleared.
+	void new_search(void);
+	void set_persistent(bool persistent);
 
    private:
-	std::unordered_map<Node, float> transposition_table;
+	// Lockless entry: `key_xor_data` holds the packed key XORed with `data`, so a slot whose two
+	// words come from different writes fails verification. An all-zero slot is empty, as valid
+	// keys are never zero: the search never stores a state with either side at zero lives.
+	//
+	// `data` layout (LSB first):
+	//   0-31: EV as float bits
+	//   32-39: number of shells left in the stored state. States with more shells root bigger
+	//          subtrees, so they are more expensive to recompute and are preferred on replacement.
+	//   40-47: value of `generation` when the entry was last stored or hit.
+	//   48: reference bit of the bucket's clock, set on a hit and cleared when a store into the
+	//       full bucket passes over the entry.
+	//   49-56: draft, the depth the EV was searched to (UNLIMITED_DEPTH if exact).
+	//   57: set if the EV is only an upper bound (EvBound::UPPER).
+	//   58-60: best action plus one, zero for chance nodes.
+	struct Entry {
+		std::atomic<uint64_t> key_xor_data;
+		std::atomic<uint64_t> data;
+	};
+
+	struct alignas(64) Bucket {
+		std::array<Entry, TRANSPOSITION_TABLE_BUCKET_SIZE> entries;
+	};
+
+	static_assert(sizeof(Bucket) == 64, "a bucket must fill exactly one cache line");
+
+	Bucket &get_bucket(uint64_t key);
+	// The entry holding `key` and its `data`, or nullptr.
+	Entry *find_entry(uint64_t key, uint64_t &data);
+	// Marks an entry as hit in the current generation.
+	void touch_entry(Entry &entry, uint64_t key, uint64_t data);
+
+	std::vector<Bucket> buckets;
+	int index_shift;
+	std::atomic<uint8_t> generation = 0;
+	bool persistent = true;
 };
 
+extern TranspositionTableManager tt_manager;
+
 #endif
@@ -0,0 +1,32 @@
+# Solves every position of POSITIONS in one batch, so later positions run on the transposition
+# table the earlier ones left behind, and again one process per position from an empty table.
+# The answers must not depend on what the process solved before.
+#
+# Usage: cmake -DSOLVER=<path> -DPOSITIONS=<path> -P warm_table_answers.cmake
+
+execute_process(
+  COMMAND ${SOLVER} --batch ${POSITIONS}
+  OUTPUT_VARIABLE warm_answers
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "Batch solve failed with ${result}.")
+endif()
+
+file(STRINGS ${POSITIONS} positions)
+set(cold_answers "")
+foreach(position IN LISTS positions)
+  file(WRITE ${CMAKE_CURRENT_BINARY_DIR}/cold_position.txt "${position}\n")
+  execute_process(
+    COMMAND ${SOLVER} --batch ${CMAKE_CURRENT_BINARY_DIR}/cold_position.txt
+    OUTPUT_VARIABLE answer
+    RESULT_VARIABLE result)
+  if(NOT result EQUAL 0)
+    message(FATAL_ERROR "Solving '${position}' failed with ${result}.")
+  endif()
+  string(APPEND cold_answers "${answer}")
+endforeach()
+
+if(NOT warm_answers STREQUAL cold_answers)
+  message(FATAL_ERROR "Answers after earlier solves:\n${warm_answers}\n"
+                      "Answers from an empty table:\n${cold_answers}")
+endif()